@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <string.h>
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+/**
+ * 异步日志后端（多缓冲）
+ * 前端线程（IO线程）只把日志行拷贝进预先分配的大缓冲区，写满了换一块空闲的，
+ * 后台线程被写满的缓冲区唤醒或者每flushInterval秒醒来一次，把写满的缓冲区整批交换出来，
+ * 在锁外写进LogFile（按大小、时间滚动），写完的缓冲区还回空闲列表重复使用
+ *
+ * 内存有上限：最多maxBuffers块缓冲区，都满了（磁盘跟不上）时新的日志直接丢弃并计数，
+ * 后台线程在文件中写一行丢弃了多少条；appendUrgent（FATAL日志）不受上限限制，不会被丢弃
+ * flush()等后台线程把调用之前的日志全部写进文件，Logger在FATAL日志之后调用它
+ *
+ * 使用：
+ *   AsyncLogging log("server", 500 * 1000 * 1000);
+ *   log.start();
+ *   Logger::instance().setOutput(std::bind(&AsyncLogging::append, &log, _1, _2));
+ *   Logger::instance().setUrgentOutput(std::bind(&AsyncLogging::appendUrgent, &log, _1, _2));
+ *   Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &log));
+ */
+class AsyncLogging : noncopyable
+{
+public:
+    AsyncLogging(const std::string &basename,
+                 off_t rollSize,
+                 int flushIntervalSeconds = 3,
+                 int maxBuffers = kDefaultMaxBuffers,
+                 int rollIntervalSeconds = 60 * 60 * 24);
+    ~AsyncLogging();
+
+    // 任意线程调用，只拷贝，不会阻塞在磁盘IO上
+    void append(const char *logline, size_t len);
+    // 缓冲区都满了时超过上限新分配一块，保证这一条不丢，用于FATAL日志
+    void appendUrgent(const char *logline, size_t len);
+    // 等待调用之前append的日志写进文件并fflush
+    void flush();
+
+    void start();
+    // 写完剩余的日志后退出后台线程
+    void stop();
+
+    // 因为缓冲区用完丢弃的日志条数（累计）
+    uint64_t droppedMessages() const { return droppedTotal_.load(std::memory_order_relaxed); }
+
+    static const size_t kBufferSize = 4 * 1024 * 1024;
+    static const int kDefaultMaxBuffers = 16;
+
+private:
+    class LogBuffer : noncopyable
+    {
+    public:
+        LogBuffer() : data_(new char[kBufferSize]), len_(0) {}
+
+        bool append(const char *buf, size_t len)
+        {
+            if (kBufferSize - len_ < len)
+            {
+                return false;
+            }
+            ::memcpy(data_.get() + len_, buf, len);
+            len_ += len;
+            return true;
+        }
+        const char* data() const { return data_.get(); }
+        size_t length() const { return len_; }
+        void reset() { len_ = 0; }
+
+    private:
+        std::unique_ptr<char[]> data_;
+        size_t len_;
+    };
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    void threadFunc();
+    // 需要持有mutex_，force为true时缓冲区用完也新分配一块，不会丢弃
+    void appendLocked(const char *logline, size_t len, bool force);
+    // 取一块空闲缓冲区，没有空闲的并且没有到达上限时新分配，已经到达上限时：
+    // force为false返回nullptr，为true超过上限分配一块，写完后释放，需要持有mutex_
+    BufferPtr takeEmptyBuffer(bool force = false);
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const int maxBuffers_;
+    const int rollInterval_;
+
+    Thread thread_;
+    std::atomic_bool running_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;          // 唤醒后台线程
+    std::condition_variable flushedCond_;   // 通知flush()的调用者
+    BufferPtr currentBuffer_;               // 前端正在写的缓冲区
+    BufferVector buffers_;                  // 写满了等待后台线程写入文件的缓冲区
+    BufferVector emptyBuffers_;             // 空闲的缓冲区
+    int allocatedBuffers_;                  // 可能暂时超过maxBuffers_，多出来的在写完后释放
+    uint64_t dropped_;                      // 还没有报告的丢弃条数
+    uint64_t flushRequested_;               // flush请求的序号
+    uint64_t flushedSeq_;                   // 后台线程完成的flush序号
+    std::atomic<uint64_t> droppedTotal_;
+};
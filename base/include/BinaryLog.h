@@ -0,0 +1,268 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+/**
+ * 延迟格式化的二进制日志（nanolog风格），用于全速记录请求级别的跟踪日志
+ * IO线程不做snprintf：每条日志只写入调用点的id、TSC时间戳和参数的原始值，
+ * 放进本线程自己的无锁单生产者单消费者环形缓冲区，满了直接丢弃并计数，不会阻塞
+ * 后台线程定期取走所有线程的记录，写成紧凑的二进制文件（用tools/decodeBinaryLog转成文本），
+ * 或者在后台线程中格式化成文本交给Logger的输出
+ *
+ * 参数只支持整数、浮点数、指针、C字符串和std::string，字符串会被拷贝
+ * 使用：
+ *   BinaryLog::instance().start("/tmp/trace.bin");
+ *   LOG_BINARY("conn %s recv %zu bytes", name.c_str(), n);
+ */
+#define LOG_BINARY(logmsgFormat, ...) \
+    do \
+    { \
+        static BinaryLog::Site muduoBinaryLogSite = {__FILE__, __LINE__, logmsgFormat, {0}}; \
+        if (0) \
+        { \
+            BinaryLog::checkFormat(logmsgFormat, ##__VA_ARGS__); \
+        } \
+        if (__builtin_expect(BinaryLog::enabled(), 0)) \
+        { \
+            BinaryLog::record(&muduoBinaryLogSite, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+class BinaryLog : noncopyable
+{
+public:
+    enum Mode
+    {
+        kBinaryFile,    // 写二进制文件
+        kText,          // 后台线程格式化成文本，交给Logger的输出
+    };
+
+    // 每个LOG_BINARY调用点一个，静态常量初始化，第一次记录时分配id
+    struct Site
+    {
+        const char *file;
+        int line;
+        const char *format;
+        std::atomic<uint32_t> id;
+    };
+
+    // 调用点的描述，二进制文件中也保存一份，解码时使用
+    struct SiteInfo
+    {
+        std::string file;
+        int line;
+        std::string format;
+        std::string argTypes;   // 每个参数一个字符：i有符号整数 u无符号整数 d浮点数 p指针 s字符串
+    };
+
+    // 每条记录的头部，后面跟着按8字节对齐的参数
+    struct RecordHeader
+    {
+        uint32_t siteId;
+        uint32_t size;      // 包括头部，8的倍数
+        uint64_t timestamp; // TSC（不支持时为CLOCK_MONOTONIC纳秒）
+    };
+
+    static BinaryLog& instance();
+
+    // path为二进制文件路径（kText模式忽略），ringBytes是每个线程的环形缓冲区大小（向上取2的幂）
+    void start(const std::string &path, Mode mode = kBinaryFile,
+               size_t ringBytes = 1 << 20, int drainIntervalMs = 10);
+    // 取走剩余的记录后停止后台线程，之后的LOG_BINARY不再记录
+    void stop();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    // 环形缓冲区满了丢弃的记录数（所有线程累计），后台线程取记录时更新
+    uint64_t droppedRecords() const { return droppedTotal_.load(std::memory_order_relaxed); }
+
+    template <typename... Args>
+    static void record(Site *site, const Args&... args)
+    {
+        uint32_t id = site->id.load(std::memory_order_acquire);
+        if (__builtin_expect(id == 0, 0))
+        {
+            std::string types;
+            appendTypes<Args...>(&types);
+            id = instance().registerSite(site, types);
+        }
+        size_t size = sizeof(RecordHeader) + argsSize(args...);
+        char *p = reserve(size);
+        if (p == nullptr)
+        {
+            return;
+        }
+        RecordHeader header = {id, static_cast<uint32_t>(size), now()};
+        ::memcpy(p, &header, sizeof header);
+        encode(p + sizeof header, args...);
+        commit();
+    }
+
+    // 只用于让编译器检查格式串和参数是否匹配，不会被调用
+    static void checkFormat(const char *, ...) __attribute__((format(printf, 1, 2))) {}
+
+    // 把TSC换算成时间需要的基准，start时校准，二进制文件的头部也保存一份
+    struct ClockBase
+    {
+        double ticksPerNs;
+        uint64_t baseTicks;
+        int64_t baseRealtimeNs;
+    };
+
+    // 把一条完整的记录（头部加参数）格式化成一行文本（带换行），追加到out，解码工具也使用它
+    static void formatRecord(const SiteInfo &site, int tid, const char *record,
+                             const ClockBase &clock, std::string *out);
+
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return monotonicNs();
+#endif
+    }
+    static uint64_t monotonicNs();
+
+    // 二进制文件的格式
+    static const char kFileMagic[8];
+    static const char kSiteTag = 'S';       // 调用点：id line file format argTypes
+    static const char kRecordsTag = 'R';    // 一个线程的一批记录：tid 字节数 记录
+    static const char kDroppedTag = 'D';    // 一个线程新丢弃的记录数：tid 个数
+    static const uint32_t kFileVersion = 1;
+    static const uint32_t kWrapMarker = 0xFFFFFFFF;     // 环形缓冲区尾部的填充
+
+    // 每个线程的环形缓冲区，定义在BinaryLog.cc中
+    struct Ring;
+
+private:
+    BinaryLog();
+    ~BinaryLog();
+
+    uint32_t registerSite(Site *site, const std::string &types);
+    // 在本线程的环形缓冲区中预留size字节（8字节对齐），空间不够时返回nullptr
+    static char* reserve(size_t size);
+    static void commit();
+    static Ring* createRing();
+
+    void threadFunc();
+    // 取走所有线程的记录并输出，返回是否取到了记录
+    bool drain();
+    void writeFileHeader();
+    void writeNewSites();
+    void outputRecords(int tid, const char *data, size_t len);
+    void outputDropped(int tid, uint64_t count);
+
+    // 按照site的格式串和参数类型，把一条记录的参数格式化成文本
+    static void formatMessage(const SiteInfo &site, const char *args, size_t len, std::string *out);
+
+    static size_t align8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+    // 参数的类型字符
+    template <typename T>
+    struct ArgType
+    {
+        static const char value = std::is_floating_point<T>::value ? 'd'
+            : std::is_pointer<T>::value ? 'p'
+            : std::is_signed<T>::value ? 'i' : 'u';
+    };
+
+    template <typename... Ts>
+    static typename std::enable_if<sizeof...(Ts) == 0>::type appendTypes(std::string *) {}
+    template <typename T, typename... Ts>
+    static void appendTypes(std::string *types)
+    {
+        // 字符串字面量推导出来是数组，先退化成指针
+        types->push_back(ArgType<typename std::decay<T>::type>::value);
+        appendTypes<Ts...>(types);
+    }
+
+    // 参数占用的字节数：标量8字节，字符串是4字节长度加内容，按8字节对齐
+    static size_t argSize(const char *s) { return align8(4 + (s ? ::strlen(s) : 0)); }
+    static size_t argSize(char *s) { return argSize(static_cast<const char*>(s)); }
+    static size_t argSize(const std::string &s) { return align8(4 + s.size()); }
+    template <typename T>
+    static size_t argSize(const T&) { return 8; }
+
+    static size_t argsSize() { return 0; }
+    template <typename T, typename... Ts>
+    static size_t argsSize(const T &arg, const Ts&... rest) { return argSize(arg) + argsSize(rest...); }
+
+    static char* encodeString(char *p, const char *s, size_t len)
+    {
+        uint32_t n = static_cast<uint32_t>(len);
+        ::memcpy(p, &n, 4);
+        ::memcpy(p + 4, s, len);
+        return p + align8(4 + len);
+    }
+    static char* encodeArg(char *p, const char *s) { return encodeString(p, s ? s : "", s ? ::strlen(s) : 0); }
+    static char* encodeArg(char *p, char *s) { return encodeArg(p, static_cast<const char*>(s)); }
+    static char* encodeArg(char *p, const std::string &s) { return encodeString(p, s.data(), s.size()); }
+    // 整数统一扩展成64位，浮点数统一保存为double，指针保存地址
+    template <typename T>
+    static char* encodeArg(char *p, const T &arg)
+    {
+        uint64_t v = toBits(arg);
+        ::memcpy(p, &v, 8);
+        return p + 8;
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_pointer<T>::value, uint64_t>::type toBits(const T &arg)
+    {
+        return reinterpret_cast<uintptr_t>(arg);
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, uint64_t>::type toBits(const T &arg)
+    {
+        double d = static_cast<double>(arg);
+        uint64_t v;
+        ::memcpy(&v, &d, 8);
+        return v;
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, uint64_t>::type
+    toBits(const T &arg)
+    {
+        return static_cast<uint64_t>(static_cast<int64_t>(arg));
+    }
+
+    static void encode(char *) {}
+    template <typename T, typename... Ts>
+    static void encode(char *p, const T &arg, const Ts&... rest)
+    {
+        encode(encodeArg(p, arg), rest...);
+    }
+
+    static std::atomic_bool enabled_;
+
+    std::mutex mutex_;                          // 保护sites_和rings_
+    std::vector<SiteInfo> sites_;               // 下标是id - 1
+    std::vector<SiteInfo> knownSites_;          // 后台线程已经同步（写进文件）的调用点，只在后台线程中使用
+    std::vector<Ring*> rings_;
+    size_t ringBytes_;
+
+    Mode mode_;
+    int drainIntervalMs_;
+    FILE *fp_;
+    std::unique_ptr<Thread> thread_;
+    std::atomic_bool running_;
+    std::vector<char> scratch_;                 // 后台线程从环形缓冲区拷贝记录用的缓冲区
+    ClockBase clock_;
+    std::atomic<uint64_t> droppedTotal_;
+};
+
+template <> struct BinaryLog::ArgType<const char*> { static const char value = 's'; };
+template <> struct BinaryLog::ArgType<char*> { static const char value = 's'; };
+template <> struct BinaryLog::ArgType<std::string> { static const char value = 's'; };
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+// CPU拓扑和线程亲和性，数据来自sched_getaffinity和/sys/devices/system下的拓扑信息
+// 只考虑当前进程允许使用的CPU（taskset/cgroup限制之后的集合）
+namespace CpuTopology
+{
+    // 当前进程允许使用的CPU编号，从小到大
+    std::vector<int> allowedCpus();
+
+    // 每个物理核只取一个CPU（超线程的兄弟只保留编号最小的那个）
+    std::vector<int> physicalCores();
+
+    // 有可用CPU的NUMA节点编号，从小到大；没有NUMA信息时返回{0}
+    std::vector<int> numaNodes();
+
+    // 节点上当前进程允许使用的CPU；没有NUMA信息时返回所有允许的CPU
+    std::vector<int> cpusOfNode(int node);
+
+    // CPU所在的NUMA节点，没有NUMA信息时返回0
+    int nodeOfCpu(int cpu);
+
+    // 把当前线程绑定到cpus上，失败返回false（errno保留）
+    bool pinCurrentThread(const std::vector<int> &cpus);
+
+    // 当前线程之后分配的内存优先从node上分配（set_mempolicy MPOL_PREFERRED），失败返回false
+    bool preferNode(int node);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 只能移动的函数对象，类似std::function，但可以指定内部缓冲区的大小
+ * 可调用对象不超过Capacity（并且对齐和移动构造满足要求）时直接构造在内部缓冲区中，
+ * 只有超过的时候才在堆上分配
+ * 
+ * std::function的内部缓冲区只有16字节，std::bind绑定一个成员函数指针和一个shared_ptr就已经放不下了，
+ * EventLoop每投递一个任务就要多一次堆分配
+ */
+template <typename Signature, size_t Capacity = 64>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+public:
+    static const size_t kCapacity = Capacity;
+
+    InplaceFunction() noexcept : ops_(nullptr) {}
+    InplaceFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+    // 从任意可调用对象构造，允许隐式转换，这样runInLoop(std::bind(...))的写法不需要修改
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, InplaceFunction>::value>::type>
+    InplaceFunction(F &&f)
+        : ops_(nullptr)
+    {
+        using Fn = typename std::decay<F>::type;
+        construct<Fn>(std::forward<F>(f), std::integral_constant<bool, fitsInline<Fn>()>());
+    }
+
+    InplaceFunction(InplaceFunction &&other) noexcept
+        : ops_(other.ops_)
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    InplaceFunction& operator=(InplaceFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            ops_ = other.ops_;
+            if (ops_ != nullptr)
+            {
+                ops_->move(&storage_, &other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InplaceFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    // 只能移动，不能拷贝
+    InplaceFunction(const InplaceFunction&) = delete;
+    InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    R operator()(Args... args) const
+    {
+        return ops_->invoke(&storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    // 可调用对象F是否会放在内部缓冲区中，不会产生堆分配
+    template <typename F>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(F) <= Capacity
+            && alignof(F) <= alignof(Storage)
+            && std::is_nothrow_move_constructible<F>::value;
+    }
+
+private:
+    using Storage = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+    // 类型擦除后的操作表，每种可调用类型一份静态实例
+    struct Ops
+    {
+        R (*invoke)(void *storage, Args&&... args);
+        void (*move)(void *dst, void *src);     // 移动构造到dst并析构src
+        void (*destroy)(void *storage);
+    };
+
+    // 可调用对象直接存放在storage_中
+    template <typename F>
+    struct InlineOps
+    {
+        static R invoke(void *storage, Args&&... args)
+        {
+            return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src)
+        {
+            F *from = static_cast<F*>(src);
+            ::new (dst) F(std::move(*from));
+            from->~F();
+        }
+        static void destroy(void *storage)
+        {
+            static_cast<F*>(storage)->~F();
+        }
+        static const Ops ops;
+    };
+
+    // 超过容量的可调用对象在堆上分配，storage_中只保存指针
+    template <typename F>
+    struct HeapOps
+    {
+        static R invoke(void *storage, Args&&... args)
+        {
+            return (**static_cast<F**>(storage))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src)
+        {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+        }
+        static void destroy(void *storage)
+        {
+            delete *static_cast<F**>(storage);
+        }
+        static const Ops ops;
+    };
+
+    template <typename Fn, typename F>
+    void construct(F &&f, std::true_type)
+    {
+        ::new (&storage_) Fn(std::forward<F>(f));
+        ops_ = &InlineOps<Fn>::ops;
+    }
+
+    template <typename Fn, typename F>
+    void construct(F &&f, std::false_type)
+    {
+        *reinterpret_cast<Fn**>(&storage_) = new Fn(std::forward<F>(f));
+        ops_ = &HeapOps<Fn>::ops;
+    }
+
+    void reset() noexcept
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    mutable Storage storage_;
+    const Ops *ops_;
+};
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename F>
+const typename InplaceFunction<R(Args...), Capacity>::Ops
+InplaceFunction<R(Args...), Capacity>::InlineOps<F>::ops = {
+    &InlineOps<F>::invoke, &InlineOps<F>::move, &InlineOps<F>::destroy
+};
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename F>
+const typename InplaceFunction<R(Args...), Capacity>::Ops
+InplaceFunction<R(Args...), Capacity>::HeapOps<F>::ops = {
+    &HeapOps<F>::invoke, &HeapOps<F>::move, &HeapOps<F>::destroy
+};
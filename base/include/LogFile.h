@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+#include <memory>
+#include <string>
+
+#include "noncopyable.h"
+
+/**
+ * 滚动日志文件，按大小和时间滚动：写入的字节数超过rollSize，或者进入新的rollInterval周期时换一个新文件
+ * 文件名：basename.年月日-时分秒.主机名.进程号.序号.log
+ * 不加锁，只能在一个线程中使用（AsyncLogging的后台线程）
+ */
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename,
+            off_t rollSize,
+            int rollIntervalSeconds = kDefaultRollInterval);
+    ~LogFile();
+
+    void append(const char *data, size_t len);
+    void flush();
+
+    // 已经滚动出来的文件个数（包括第一个）
+    int fileCount() const { return fileCount_; }
+
+    static const int kDefaultRollInterval = 60 * 60 * 24;
+
+private:
+    void rollFile(time_t now);
+    std::string logFileName(time_t now) const;
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int rollInterval_;
+
+    FILE *fp_;
+    std::unique_ptr<char[]> ioBuffer_;  // 给stdio的缓冲区，攒够了再write
+    off_t writtenBytes_;
+    time_t periodStart_;                // 当前文件所在周期的起点
+    int fileCount_;
+};
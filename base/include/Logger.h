@@ -1,74 +1,94 @@
 #pragma once
 
 #include <string>
+#include <functional>
+#include <atomic>
 
 #include "noncopyable.h"
-// 定义宏方便使用（在定义宏的时候需要使用\来作为续行符）
-// LOG_INFO("%s %d", arg1, arg2)
-#define LOG_INFO(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while (0);
 
-#define LOG_ERROR(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while (0);
+// 定义日志级别 DEBUG INFO ERROR FATAL，按严重程度从低到高排列
+enum LogLevel {
+    DEBUG,      // 调试信息
+    INFO,       // 普通信息
+    ERROR,      // 错误信息
+    FATAL,      // core信息
+};
 
-#define LOG_FATAL(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while (0);
+// 编译期的最低级别（0 DEBUG，1 INFO，2 ERROR，3 FATAL），低于它的日志语句在预处理时就被去掉
+// release构建由CMakeLists.txt设置为2，只保留ERROR和FATAL；定义了MUDEBUG时去掉DEBUG（和原来一样）
+#ifndef MUDUO_LOG_MIN_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_LOG_MIN_LEVEL 1
+#else
+#define MUDUO_LOG_MIN_LEVEL 0
+#endif
+#endif
 
-// 由于调试信息较多，可以使用宏来指定默认不输出
-#ifndef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...) \
+// 先检查运行期的级别阈值，被关闭的日志语句只有一次原子读和一次比较，不会格式化
+#define MUDUO_LOG(level, logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(DEBUG); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while (0);
+        if (__builtin_expect(Logger::enabled(level), 0)) \
+        { \
+            Logger::instance().log(level, logmsgFormat, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// 定义宏方便使用（在定义宏的时候需要使用\来作为续行符）
+// LOG_INFO("%s %d", arg1, arg2)
+#if MUDUO_LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG(DEBUG, logmsgFormat, ##__VA_ARGS__)
 #else
-    #define LOG_DEBUG(logmsgFormat, ...)
+#define LOG_DEBUG(logmsgFormat, ...) do {} while (0)
 #endif
 
-// 定义日志级别 INFO ERROR FATAL DEBUG 
+#if MUDUO_LOG_MIN_LEVEL <= 1
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO(logmsgFormat, ...) do {} while (0)
+#endif
 
-enum LogLevel {
-    INFO,       // 普通信息
-    ERROR,      // 错误信息
-    FATAL,      // core信息
-    DEBUG,      // 调试信息
-};
+#if MUDUO_LOG_MIN_LEVEL <= 2
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(logmsgFormat, ...) do {} while (0)
+#endif
+
+// FATAL不受任何阈值影响
+#define LOG_FATAL(logmsgFormat, ...) Logger::instance().log(FATAL, logmsgFormat, ##__VA_ARGS__)
 
 class Logger : noncopyable
 {
 public:
+    // 输出一行完整的日志（带换行），flush把已经输出的日志落盘
+    using OutputFunc = std::function<void(const char *msg, size_t len)>;
+    using FlushFunc = std::function<void()>;
+
     // 获取日志的唯一实例（单例模式）
     static Logger& instance();
-    // 设置日志级别
-    void setLogLevel(int Level);
-    // 写日志
-    void log(std::string msg);
+
+    // 运行期的级别阈值，低于它的日志不输出，任意线程都可以修改
+    // 默认DEBUG（全部输出），启动时可以用环境变量MUDUO_LOG_LEVEL=DEBUG/INFO/ERROR/FATAL设置
+    static void setLogLevel(int level) { threshold_.store(level, std::memory_order_relaxed); }
+    static int logLevel() { return threshold_.load(std::memory_order_relaxed); }
+    static bool enabled(int level) { return level >= threshold_.load(std::memory_order_relaxed); }
+
+    // 写日志 [级别信息] [time] : [msg]
+    void log(int level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+    // 输出已经格式化好的日志行（BinaryLog的文本模式使用），不检查阈值
+    void write(const char *line, size_t len) { output_(line, len); }
+
+    // 默认写到stdout，可以换成AsyncLogging::append/flush，需要在其他线程开始写日志之前设置
+    // FATAL日志输出之后会调用flush，保证进程退出前它已经落盘
+    void setOutput(OutputFunc out);
+    void setFlush(FlushFunc flush);
+    // FATAL日志单独的输出，不能被丢弃（比如AsyncLogging::appendUrgent），没有设置时使用output
+    void setUrgentOutput(OutputFunc out);
 private:
-    int logLevel_;  // 为了和系统变量不会冲突
-    Logger() {}
-};
\ No newline at end of file
+    static std::atomic_int threshold_;
+
+    OutputFunc output_;
+    OutputFunc urgentOutput_;
+    FlushFunc flush_;
+    Logger();
+};
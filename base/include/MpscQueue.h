@@ -0,0 +1,119 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <stddef.h>
+
+// 缓存行大小，用于对齐被多个线程频繁访问的原子变量，避免伪共享
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * 侵入式无锁多生产者单消费者队列（Dmitry Vyukov MPSC算法）
+ * Node需要有一个成员 std::atomic<Node*> next
+ * 
+ * push可以在任意线程调用，只有一次exchange，不会阻塞
+ * pop/beginBatch/popBatch只能在消费者线程调用，生产者正在push的中间状态会暂时返回nullptr，
+ * 调用方需要保证生产者push之后会再次通知消费者（例如EventLoop的wakeup）
+ */
+template <typename Node>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue()
+        : head_(&stub_)
+        , tail_(&stub_)
+        , batchEnd_(nullptr)
+        , stubPassed_(false)
+    {
+        stub_.next.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // 生产者入队
+    void push(Node *node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 消费者出队，队列为空（或生产者还没有完成链接）时返回nullptr
+    Node* pop()
+    {
+        Node *tail = tail_;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_)
+        {
+            if (next == nullptr)
+            {
+                return nullptr;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+            stubPassed_ = true;
+        }
+
+        if (next != nullptr)
+        {
+            tail_ = next;
+            return tail;
+        }
+
+        Node *head = head_.load(std::memory_order_acquire);
+        if (tail != head)
+        {
+            // 有生产者交换了head但还没有链接next
+            return nullptr;
+        }
+
+        // 只剩最后一个节点，重新放入stub_才能把它取出来
+        push(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    // 消费者开始一批处理：记录调用时最后入队的节点作为这一批的终点，返回false表示队列为空
+    // 之后用popBatch逐个取出，终点之后入队的节点留给下一批（最多多取一个）
+    bool beginBatch()
+    {
+        batchEnd_ = head_.load(std::memory_order_acquire);
+        stubPassed_ = false;
+        // pop重新放入stub_时如果正好有生产者入队，链表会是 tail -> ... -> stub_，
+        // 此时head_是stub_但前面还有节点，只有tail_也是stub_时队列才真的为空
+        if (batchEnd_ == &stub_ && tail_ == &stub_)
+        {
+            batchEnd_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // 取出这一批的下一个节点，这一批取完（或者生产者还没有完成链接）时返回nullptr
+    Node* popBatch()
+    {
+        if (batchEnd_ == nullptr)
+        {
+            return nullptr;
+        }
+        Node *node = pop();
+        // 终点是stub_时，越过stub_之后取到的节点都是开始之后才入队的
+        if (node == nullptr || node == batchEnd_ || (batchEnd_ == &stub_ && stubPassed_))
+        {
+            batchEnd_ = nullptr;
+        }
+        return node;
+    }
+
+private:
+    alignas(kCacheLineSize) std::atomic<Node*> head_;   // 生产者竞争的位置
+    alignas(kCacheLineSize) Node *tail_;                // 只有消费者访问
+    Node *batchEnd_;        // 当前这一批的终点，nullptr表示这一批已经结束
+    bool stubPassed_;       // 这一批中pop越过了stub_
+    Node stub_;
+};
@@ -2,15 +2,65 @@
 
 #include <iostream>
 #include <string>
+#include <stdint.h>
 
 class Timestamp
 {
 public:
+    // now()使用的时钟源
+    enum ClockSource
+    {
+        kSystemClock,   // gettimeofday（vDSO），默认
+        kTscClock,      // rdtsc按校准的频率换算，每个线程每秒用vDSO的clock_gettime重新对齐一次
+    };
+
     Timestamp();
     // 这里是防止隐式转换
     explicit Timestamp(int64_t microSecondsSinceEpoch);
     static Timestamp now();
+    static Timestamp invalid() { return Timestamp(); }
+
+    // 切换时钟源，返回实际使用的时钟源：CPU不支持不变的TSC（constant_tsc和nonstop_tsc）时仍然是kSystemClock
+    // 第一次切换到kTscClock时对照CLOCK_MONOTONIC校准10毫秒，任意线程都可以调用
+    static ClockSource setClockSource(ClockSource source);
+    static ClockSource clockSource();
+
+    // "年/月/日 时:分:秒"
     std::string toString() const;
+    // "年/月/日 时:分:秒.微秒"
+    std::string toFormattedString(bool showMicroseconds = true) const;
+    // 格式化到buf中，返回长度，不分配内存
+    // 每个线程缓存上一次格式化的秒数和结果，同一秒内只重写微秒，不再调用localtime
+    int formatTo(char *buf, size_t len, bool showMicroseconds = true) const;
+
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
 private:
     int64_t microSecondsSinceEpoch_;
-};
\ No newline at end of file
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// 两个时间点的差值，单位秒
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+// 在timestamp的基础上加上seconds秒
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
@@ -0,0 +1,183 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <chrono>
+
+AsyncLogging::AsyncLogging(const std::string &basename,
+                           off_t rollSize,
+                           int flushIntervalSeconds,
+                           int maxBuffers,
+                           int rollIntervalSeconds)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , flushInterval_(flushIntervalSeconds)
+    , maxBuffers_(maxBuffers < 2 ? 2 : maxBuffers)
+    , rollInterval_(rollIntervalSeconds)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "AsyncLogging")
+    , running_(false)
+    , currentBuffer_(new LogBuffer)
+    , allocatedBuffers_(1)
+    , dropped_(0)
+    , flushRequested_(0)
+    , flushedSeq_(0)
+    , droppedTotal_(0)
+{
+    // 预先分配一块备用，前端第一次写满时不需要在锁里分配
+    emptyBuffers_.push_back(BufferPtr(new LogBuffer));
+    ++allocatedBuffers_;
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        cond_.notify_one();
+    }
+    thread_.join();
+}
+
+void AsyncLogging::append(const char *logline, size_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    appendLocked(logline, len, false);
+}
+
+void AsyncLogging::appendUrgent(const char *logline, size_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    appendLocked(logline, len, true);
+}
+
+void AsyncLogging::appendLocked(const char *logline, size_t len, bool force)
+{
+    if (currentBuffer_->append(logline, len))
+    {
+        return;
+    }
+
+    BufferPtr next = takeEmptyBuffer(force);
+    if (!next)
+    {
+        // 所有缓冲区都满了，后台线程跟不上，丢弃这一条，内存不再增长
+        ++dropped_;
+        droppedTotal_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffers_.push_back(std::move(currentBuffer_));
+    currentBuffer_ = std::move(next);
+    // 超过一块缓冲区的日志行截断
+    currentBuffer_->append(logline, len < kBufferSize ? len : kBufferSize);
+    cond_.notify_one();
+}
+
+AsyncLogging::BufferPtr AsyncLogging::takeEmptyBuffer(bool force)
+{
+    BufferPtr buffer;
+    if (!emptyBuffers_.empty())
+    {
+        buffer = std::move(emptyBuffers_.back());
+        emptyBuffers_.pop_back();
+    }
+    else if (allocatedBuffers_ < maxBuffers_ || force)
+    {
+        buffer.reset(new LogBuffer);
+        ++allocatedBuffers_;
+    }
+    return buffer;
+}
+
+void AsyncLogging::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_)
+    {
+        return;
+    }
+    uint64_t seq = ++flushRequested_;
+    cond_.notify_one();
+    flushedCond_.wait(lock, [this, seq]() { return flushedSeq_ >= seq || !running_; });
+}
+
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_, rollInterval_);
+    BufferVector buffersToWrite;
+    bool exiting = false;
+    while (!exiting)
+    {
+        uint64_t dropped = 0;
+        uint64_t flushSeq = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty() && flushRequested_ == flushedSeq_ && running_)
+            {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            exiting = !running_;
+            flushSeq = flushRequested_;
+            // 正在写的缓冲区也一起拿走，保证每flushInterval秒日志都能落盘
+            if (currentBuffer_->length() > 0)
+            {
+                // 退出前和有flush()在等待时必须写完，缓冲区用完了也超过上限换一块新的，
+                // 否则flush()返回时正在写的缓冲区（比如刚写进去的FATAL日志）还没有落盘
+                BufferPtr next = takeEmptyBuffer(exiting || flushSeq != flushedSeq_);
+                if (next)
+                {
+                    buffers_.push_back(std::move(currentBuffer_));
+                    currentBuffer_ = std::move(next);
+                }
+            }
+            buffersToWrite.swap(buffers_);
+            dropped = dropped_;
+            dropped_ = 0;
+        }
+
+        // 下面在锁外写文件，前端可以继续append
+        if (dropped > 0)
+        {
+            char buf[128];
+            int n = snprintf(buf, sizeof buf, "[ERROR]%s : AsyncLogging dropped %llu log messages\n",
+                             Timestamp::now().toFormattedString().c_str(), (unsigned long long)dropped);
+            output.append(buf, n);
+        }
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data(), buffer->length());
+        }
+        output.flush();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (BufferPtr &buffer : buffersToWrite)
+        {
+            if (allocatedBuffers_ > maxBuffers_)
+            {
+                // 超过上限临时分配的缓冲区，写完就释放，内存回到上限以内
+                --allocatedBuffers_;
+                continue;
+            }
+            buffer->reset();
+            emptyBuffers_.push_back(std::move(buffer));
+        }
+        buffersToWrite.clear();
+        // 这一轮拿走的缓冲区已经写进文件，flushSeq之前的flush()可以返回了
+        flushedSeq_ = flushSeq;
+        flushedCond_.notify_all();
+    }
+}
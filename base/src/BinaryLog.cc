@@ -0,0 +1,628 @@
+#include "BinaryLog.h"
+#include "CurrentThread.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include <new>
+
+const char BinaryLog::kFileMagic[8] = {'M', 'U', 'D', 'U', 'O', 'B', 'L', 'G'};
+const char BinaryLog::kSiteTag;
+const char BinaryLog::kRecordsTag;
+const char BinaryLog::kDroppedTag;
+const uint32_t BinaryLog::kFileVersion;
+const uint32_t BinaryLog::kWrapMarker;
+
+std::atomic_bool BinaryLog::enabled_(false);
+
+// 每个线程一个的单生产者单消费者环形缓冲区
+// writePos/readPos是一直递增的字节数，下标是它们和mask的与
+struct BinaryLog::Ring
+{
+    explicit Ring(size_t bytes)
+        : buffer(new char[bytes])
+        , capacity(bytes)
+        , mask(bytes - 1)
+        , tid(CurrentThread::tid())
+        , writePos(0)
+        , cachedReadPos(0)
+        , pendingPos(0)
+        , dropped(0)
+        , readPos(0)
+        , reportedDropped(0)
+        , retired(false)
+    {
+    }
+
+    // 成员按缓存行对齐，C++11的new不保证超过alignof(max_align_t)的对齐，用posix_memalign分配
+    static Ring* create(size_t bytes)
+    {
+        void *p = nullptr;
+        if (::posix_memalign(&p, alignof(Ring), sizeof(Ring)) != 0)
+        {
+            LOG_FATAL("BinaryLog::Ring posix_memalign failed \n");
+        }
+        return new (p) Ring(bytes);
+    }
+
+    static void destroy(Ring *ring)
+    {
+        ring->~Ring();
+        ::free(ring);
+    }
+
+    std::unique_ptr<char[]> buffer;
+    const size_t capacity;
+    const size_t mask;
+    const int tid;
+
+    // 下面是生产者（记录日志的线程）使用的
+    alignas(64) std::atomic<uint64_t> writePos;
+    uint64_t cachedReadPos;     // 上一次看到的readPos，空间足够时不读消费者的缓存行
+    uint64_t pendingPos;        // reserve之后commit要发布的writePos
+    std::atomic<uint64_t> dropped;
+
+    // 下面是消费者（后台线程）使用的
+    alignas(64) std::atomic<uint64_t> readPos;
+    uint64_t reportedDropped;
+    std::atomic_bool retired;   // 线程已经退出，取完记录后释放
+};
+
+// 热路径只访问POD的__thread指针，线程退出时由thread_local对象的析构函数标记环形缓冲区
+static __thread BinaryLog::Ring *t_ring = nullptr;
+
+namespace
+{
+struct RingRetirer
+{
+    BinaryLog::Ring *ring = nullptr;
+    ~RingRetirer();
+};
+thread_local RingRetirer t_retirer;
+}
+
+RingRetirer::~RingRetirer()
+{
+    if (ring)
+    {
+        ring->retired.store(true, std::memory_order_release);
+        t_ring = nullptr;
+    }
+}
+
+static int64_t realtimeNs()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t BinaryLog::monotonicNs()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+BinaryLog& BinaryLog::instance()
+{
+    static BinaryLog log;
+    return log;
+}
+
+BinaryLog::BinaryLog()
+    : ringBytes_(1 << 20)
+    , mode_(kBinaryFile)
+    , drainIntervalMs_(10)
+    , fp_(nullptr)
+    , running_(false)
+    , droppedTotal_(0)
+{
+    clock_.ticksPerNs = 1.0;
+    clock_.baseTicks = 0;
+    clock_.baseRealtimeNs = 0;
+}
+
+BinaryLog::~BinaryLog()
+{
+    if (running_)
+    {
+        stop();
+    }
+    // 环形缓冲区可能还有线程在使用，进程退出时不释放
+}
+
+void BinaryLog::start(const std::string &path, Mode mode, size_t ringBytes, int drainIntervalMs)
+{
+    if (running_)
+    {
+        return;
+    }
+    size_t bytes = 4096;
+    while (bytes < ringBytes)
+    {
+        bytes <<= 1;
+    }
+    ringBytes_ = bytes;
+    mode_ = mode;
+    drainIntervalMs_ = drainIntervalMs > 0 ? drainIntervalMs : 1;
+
+    if (mode_ == kBinaryFile)
+    {
+        fp_ = ::fopen(path.c_str(), "we");
+        if (fp_ == nullptr)
+        {
+            LOG_ERROR("BinaryLog::start open %s failed errno=%d \n", path.c_str(), errno);
+            return;
+        }
+    }
+
+    // 校准TSC频率：对照单调时钟测10毫秒
+    uint64_t ticks0 = now();
+    uint64_t mono0 = monotonicNs();
+    clock_.baseTicks = ticks0;
+    clock_.baseRealtimeNs = realtimeNs();
+    ::usleep(10 * 1000);
+    uint64_t ticks1 = now();
+    uint64_t mono1 = monotonicNs();
+    clock_.ticksPerNs = mono1 > mono0 ? static_cast<double>(ticks1 - ticks0) / (mono1 - mono0) : 1.0;
+
+    // 新文件要重新写一遍调用点
+    knownSites_.clear();
+    if (fp_)
+    {
+        writeFileHeader();
+    }
+
+    running_ = true;
+    thread_.reset(new Thread(std::bind(&BinaryLog::threadFunc, this), "BinaryLog"));
+    thread_->start();
+    enabled_.store(true, std::memory_order_release);
+}
+
+void BinaryLog::stop()
+{
+    enabled_.store(false, std::memory_order_release);
+    running_ = false;
+    if (thread_)
+    {
+        thread_->join();
+        thread_.reset();
+    }
+    if (fp_)
+    {
+        ::fclose(fp_);
+        fp_ = nullptr;
+    }
+}
+
+uint32_t BinaryLog::registerSite(Site *site, const std::string &types)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 多个线程同时第一次走到同一个调用点时只分配一个id
+    uint32_t id = site->id.load(std::memory_order_relaxed);
+    if (id == 0)
+    {
+        SiteInfo info;
+        info.file = site->file;
+        info.line = site->line;
+        info.format = site->format;
+        info.argTypes = types;
+        sites_.push_back(info);
+        id = static_cast<uint32_t>(sites_.size());
+        site->id.store(id, std::memory_order_release);
+    }
+    return id;
+}
+
+BinaryLog::Ring* BinaryLog::createRing()
+{
+    BinaryLog &log = instance();
+    Ring *ring = Ring::create(log.ringBytes_);
+    {
+        std::lock_guard<std::mutex> lock(log.mutex_);
+        log.rings_.push_back(ring);
+    }
+    t_retirer.ring = ring;
+    t_ring = ring;
+    return ring;
+}
+
+char* BinaryLog::reserve(size_t size)
+{
+    Ring *ring = t_ring;
+    if (__builtin_expect(ring == nullptr, 0))
+    {
+        ring = createRing();
+    }
+
+    uint64_t pos = ring->writePos.load(std::memory_order_relaxed);
+    size_t offset = pos & ring->mask;
+    // 记录不跨越缓冲区的末尾，放不下时在末尾填充，从头开始写
+    size_t padding = offset + size > ring->capacity ? ring->capacity - offset : 0;
+    uint64_t end = pos + padding + size;
+    if (end - ring->cachedReadPos > ring->capacity)
+    {
+        ring->cachedReadPos = ring->readPos.load(std::memory_order_acquire);
+        if (end - ring->cachedReadPos > ring->capacity)
+        {
+            // 满了直接丢弃，只有本线程修改dropped
+            ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+    if (padding > 0)
+    {
+        ::memcpy(ring->buffer.get() + offset, &kWrapMarker, sizeof kWrapMarker);
+    }
+    ring->pendingPos = end;
+    return ring->buffer.get() + ((pos + padding) & ring->mask);
+}
+
+void BinaryLog::commit()
+{
+    Ring *ring = t_ring;
+    ring->writePos.store(ring->pendingPos, std::memory_order_release);
+}
+
+void BinaryLog::threadFunc()
+{
+    while (running_)
+    {
+        if (!drain())
+        {
+            ::usleep(drainIntervalMs_ * 1000);
+        }
+    }
+    // 把停止之前的记录取完
+    while (drain())
+    {
+    }
+}
+
+bool BinaryLog::drain()
+{
+    struct Chunk
+    {
+        int tid;
+        size_t offset;
+        size_t len;
+    };
+    std::vector<Chunk> chunks;
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings = rings_;
+    }
+
+    // 先把所有线程的记录拷贝出来，尽快腾出环形缓冲区的空间
+    scratch_.clear();
+    std::vector<Ring*> retired;
+    for (Ring *ring : rings)
+    {
+        // 先读retired再读writePos，线程退出前写的记录一定能看到
+        bool exited = ring->retired.load(std::memory_order_acquire);
+        uint64_t r = ring->readPos.load(std::memory_order_relaxed);
+        uint64_t w = ring->writePos.load(std::memory_order_acquire);
+        size_t begin = scratch_.size();
+        const char *buf = ring->buffer.get();
+        while (r < w)
+        {
+            size_t offset = r & ring->mask;
+            uint32_t first;
+            ::memcpy(&first, buf + offset, sizeof first);
+            if (first == kWrapMarker)
+            {
+                r += ring->capacity - offset;
+                continue;
+            }
+            RecordHeader header;
+            ::memcpy(&header, buf + offset, sizeof header);
+            scratch_.insert(scratch_.end(), buf + offset, buf + offset + header.size);
+            r += header.size;
+        }
+        ring->readPos.store(r, std::memory_order_release);
+        if (scratch_.size() > begin)
+        {
+            chunks.push_back(Chunk{ring->tid, begin, scratch_.size() - begin});
+        }
+
+        uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+        if (dropped != ring->reportedDropped)
+        {
+            uint64_t delta = dropped - ring->reportedDropped;
+            ring->reportedDropped = dropped;
+            droppedTotal_.fetch_add(delta, std::memory_order_relaxed);
+            outputDropped(ring->tid, delta);
+        }
+        if (exited)
+        {
+            retired.push_back(ring);
+        }
+    }
+
+    // 记录引用的调用点在写记录之前都已经注册，先写调用点再写记录
+    writeNewSites();
+    for (const Chunk &chunk : chunks)
+    {
+        outputRecords(chunk.tid, scratch_.data() + chunk.offset, chunk.len);
+    }
+    if (fp_ && !chunks.empty())
+    {
+        ::fflush(fp_);
+    }
+
+    if (!retired.empty())
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Ring *ring : retired)
+        {
+            for (size_t i = 0; i < rings_.size(); ++i)
+            {
+                if (rings_[i] == ring)
+                {
+                    rings_[i] = rings_.back();
+                    rings_.pop_back();
+                    break;
+                }
+            }
+            Ring::destroy(ring);
+        }
+    }
+    return !chunks.empty();
+}
+
+static void writeBytes(FILE *fp, const void *data, size_t len)
+{
+    if (::fwrite(data, 1, len, fp) != len)
+    {
+        fprintf(stderr, "BinaryLog write failed\n");
+    }
+}
+
+static void writeU32(FILE *fp, uint32_t v)
+{
+    writeBytes(fp, &v, sizeof v);
+}
+
+static void writeString(FILE *fp, const std::string &s)
+{
+    writeU32(fp, static_cast<uint32_t>(s.size()));
+    writeBytes(fp, s.data(), s.size());
+}
+
+// 文件头：magic 版本号 ClockBase
+void BinaryLog::writeFileHeader()
+{
+    writeBytes(fp_, kFileMagic, sizeof kFileMagic);
+    writeU32(fp_, kFileVersion);
+    writeBytes(fp_, &clock_.ticksPerNs, sizeof clock_.ticksPerNs);
+    writeBytes(fp_, &clock_.baseTicks, sizeof clock_.baseTicks);
+    writeBytes(fp_, &clock_.baseRealtimeNs, sizeof clock_.baseRealtimeNs);
+}
+
+void BinaryLog::writeNewSites()
+{
+    size_t first = knownSites_.size();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        knownSites_.insert(knownSites_.end(), sites_.begin() + first, sites_.end());
+    }
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+    for (size_t i = first; i < knownSites_.size(); ++i)
+    {
+        const SiteInfo &site = knownSites_[i];
+        writeBytes(fp_, &kSiteTag, 1);
+        writeU32(fp_, static_cast<uint32_t>(i + 1));
+        writeU32(fp_, static_cast<uint32_t>(site.line));
+        writeString(fp_, site.file);
+        writeString(fp_, site.format);
+        writeString(fp_, site.argTypes);
+    }
+}
+
+void BinaryLog::outputRecords(int tid, const char *data, size_t len)
+{
+    if (mode_ == kBinaryFile)
+    {
+        writeBytes(fp_, &kRecordsTag, 1);
+        writeU32(fp_, static_cast<uint32_t>(tid));
+        writeU32(fp_, static_cast<uint32_t>(len));
+        writeBytes(fp_, data, len);
+        return;
+    }
+
+    // 文本模式：在后台线程中格式化
+    std::string text;
+    const char *end = data + len;
+    while (data < end)
+    {
+        RecordHeader header;
+        ::memcpy(&header, data, sizeof header);
+        formatRecord(knownSites_[header.siteId - 1], tid, data, clock_, &text);
+        data += header.size;
+    }
+    Logger::instance().write(text.data(), text.size());
+}
+
+void BinaryLog::outputDropped(int tid, uint64_t count)
+{
+    if (mode_ == kBinaryFile)
+    {
+        if (fp_)
+        {
+            writeBytes(fp_, &kDroppedTag, 1);
+            writeU32(fp_, static_cast<uint32_t>(tid));
+            writeBytes(fp_, &count, sizeof count);
+        }
+        return;
+    }
+    LOG_ERROR("BinaryLog dropped %llu records of thread %d \n", (unsigned long long)count, tid);
+}
+
+void BinaryLog::formatRecord(const SiteInfo &site, int tid, const char *record,
+                             const ClockBase &clock, std::string *out)
+{
+    RecordHeader header;
+    ::memcpy(&header, record, sizeof header);
+
+    int64_t deltaTicks = static_cast<int64_t>(header.timestamp - clock.baseTicks);
+    int64_t ns = clock.baseRealtimeNs + static_cast<int64_t>(deltaTicks / clock.ticksPerNs);
+    char time[64];
+    Timestamp(ns / 1000).formatTo(time, sizeof time);
+
+    const char *file = ::strrchr(site.file.c_str(), '/');
+    file = file ? file + 1 : site.file.c_str();
+
+    char prefix[256];
+    snprintf(prefix, sizeof prefix, "[TRACE]%s %d %s:%d : ", time, tid, file, site.line);
+    out->append(prefix);
+    formatMessage(site, record + sizeof header, header.size - sizeof header, out);
+    if (out->empty() || out->back() != '\n')
+    {
+        out->push_back('\n');
+    }
+}
+
+void BinaryLog::formatMessage(const SiteInfo &site, const char *args, size_t len, std::string *out)
+{
+    const char *end = args + len;
+    size_t argIndex = 0;
+    // 按照参数类型依次读出参数，读完或者数据不够时返回false
+    auto nextArg = [&](char *type, uint64_t *value, std::string *str) -> bool {
+        if (argIndex >= site.argTypes.size() || args + 8 > end)
+        {
+            return false;
+        }
+        *type = site.argTypes[argIndex++];
+        if (*type == 's')
+        {
+            uint32_t n;
+            ::memcpy(&n, args, sizeof n);
+            if (args + 4 + n > end)
+            {
+                return false;
+            }
+            str->assign(args + 4, n);
+            args += align8(4 + n);
+        }
+        else
+        {
+            ::memcpy(value, args, 8);
+            args += 8;
+        }
+        return true;
+    };
+
+    const char *fmt = site.format.c_str();
+    char buf[512];
+    while (*fmt)
+    {
+        if (*fmt != '%')
+        {
+            out->push_back(*fmt++);
+            continue;
+        }
+        if (fmt[1] == '%')
+        {
+            out->push_back('%');
+            fmt += 2;
+            continue;
+        }
+
+        // 解析一个转换说明，去掉长度修饰符，'*'直接替换成参数的值
+        std::string spec("%");
+        ++fmt;
+        while (*fmt && ::strchr("-+ #0", *fmt))
+        {
+            spec.push_back(*fmt++);
+        }
+        for (int part = 0; part < 2; ++part)
+        {
+            if (part == 1)
+            {
+                if (*fmt != '.')
+                {
+                    break;
+                }
+                spec.push_back(*fmt++);
+            }
+            if (*fmt == '*')
+            {
+                char type;
+                uint64_t value = 0;
+                std::string str;
+                nextArg(&type, &value, &str);
+                spec += std::to_string(static_cast<int>(value));
+                ++fmt;
+            }
+            while (*fmt >= '0' && *fmt <= '9')
+            {
+                spec.push_back(*fmt++);
+            }
+        }
+        while (*fmt && ::strchr("hlLqjzt", *fmt))
+        {
+            ++fmt;
+        }
+        char conv = *fmt;
+        if (conv == '\0')
+        {
+            break;
+        }
+        ++fmt;
+
+        char type;
+        uint64_t value = 0;
+        std::string str;
+        if (!nextArg(&type, &value, &str))
+        {
+            out->append("<?>");
+            continue;
+        }
+
+        double d;
+        ::memcpy(&d, &value, sizeof d);
+        if (type == 's' || conv == 's')
+        {
+            if (type != 's')
+            {
+                str = type == 'd' ? std::to_string(d) : std::to_string(static_cast<long long>(value));
+            }
+            snprintf(buf, sizeof buf, (spec + "s").c_str(), str.c_str());
+        }
+        else if (::strchr("fFeEgGaA", conv))
+        {
+            snprintf(buf, sizeof buf, (spec + conv).c_str(),
+                     type == 'd' ? d : static_cast<double>(static_cast<int64_t>(value)));
+        }
+        else if (conv == 'd' || conv == 'i')
+        {
+            snprintf(buf, sizeof buf, (spec + "lld").c_str(), static_cast<long long>(value));
+        }
+        else if (::strchr("uoxX", conv))
+        {
+            snprintf(buf, sizeof buf, (spec + "ll" + conv).c_str(), static_cast<unsigned long long>(value));
+        }
+        else if (conv == 'c')
+        {
+            snprintf(buf, sizeof buf, (spec + "c").c_str(), static_cast<int>(value));
+        }
+        else if (conv == 'p')
+        {
+            snprintf(buf, sizeof buf, (spec + "p").c_str(), reinterpret_cast<void*>(static_cast<uintptr_t>(value)));
+        }
+        else
+        {
+            buf[0] = '\0';
+        }
+        out->append(buf);
+    }
+}
@@ -0,0 +1,187 @@
+#include "CpuTopology.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+// <linux/mempolicy.h>里的MPOL_PREFERRED，直接使用系统调用，不依赖libnuma
+static const int kMpolPreferred = 1;
+
+// 读取sysfs中的一个整数，失败返回-1
+static int readInt(const char *path)
+{
+    FILE *fp = ::fopen(path, "r");
+    if (fp == nullptr)
+    {
+        return -1;
+    }
+    int value = -1;
+    if (::fscanf(fp, "%d", &value) != 1)
+    {
+        value = -1;
+    }
+    ::fclose(fp);
+    return value;
+}
+
+// 解析"0-3,8-11"格式的CPU列表
+static std::vector<int> readCpuList(const char *path)
+{
+    std::vector<int> cpus;
+    FILE *fp = ::fopen(path, "r");
+    if (fp == nullptr)
+    {
+        return cpus;
+    }
+    int first = 0;
+    while (::fscanf(fp, "%d", &first) == 1)
+    {
+        int last = first;
+        int c = ::fgetc(fp);
+        if (c == '-')
+        {
+            if (::fscanf(fp, "%d", &last) != 1)
+            {
+                break;
+            }
+            c = ::fgetc(fp);
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+        if (c != ',')
+        {
+            break;
+        }
+    }
+    ::fclose(fp);
+    return cpus;
+}
+
+namespace CpuTopology
+{
+    std::vector<int> allowedCpus()
+    {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (::sched_getaffinity(0, sizeof set, &set) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &set))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        if (cpus.empty())
+        {
+            cpus.push_back(0);
+        }
+        return cpus;
+    }
+
+    std::vector<int> physicalCores()
+    {
+        std::vector<int> cores;
+        std::set<std::pair<int, int>> seen;  // (physical_package_id, core_id)
+        char path[128];
+        for (int cpu : allowedCpus())
+        {
+            snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+            int package = readInt(path);
+            snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+            int core = readInt(path);
+            // 读不到拓扑信息时每个CPU都当作一个物理核
+            if (core < 0 || seen.insert(std::make_pair(package, core)).second)
+            {
+                cores.push_back(cpu);
+            }
+        }
+        return cores;
+    }
+
+    std::vector<int> numaNodes()
+    {
+        std::vector<int> nodes;
+        std::vector<int> online = readCpuList("/sys/devices/system/node/online");
+        for (int node : online)
+        {
+            if (!cpusOfNode(node).empty())
+            {
+                nodes.push_back(node);
+            }
+        }
+        if (nodes.empty())
+        {
+            nodes.push_back(0);
+        }
+        return nodes;
+    }
+
+    std::vector<int> cpusOfNode(int node)
+    {
+        std::vector<int> allowed = allowedCpus();
+        char path[128];
+        snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+        std::vector<int> nodeCpus = readCpuList(path);
+        if (nodeCpus.empty())
+        {
+            return node == 0 ? allowed : nodeCpus;
+        }
+        std::vector<int> cpus;
+        for (int cpu : nodeCpus)
+        {
+            if (std::binary_search(allowed.begin(), allowed.end(), cpu))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    int nodeOfCpu(int cpu)
+    {
+        for (int node : readCpuList("/sys/devices/system/node/online"))
+        {
+            char path[128];
+            snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+            std::vector<int> cpus = readCpuList(path);
+            if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+            {
+                return node;
+            }
+        }
+        return 0;
+    }
+
+    bool pinCurrentThread(const std::vector<int> &cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+        return ::sched_setaffinity(0, sizeof set, &set) == 0;
+    }
+
+    bool preferNode(int node)
+    {
+        unsigned long mask[16] = {0};
+        const int bits = static_cast<int>(sizeof(unsigned long) * 8);
+        if (node < 0 || node >= bits * 16)
+        {
+            return false;
+        }
+        mask[node / bits] = 1UL << (node % bits);
+        return ::syscall(SYS_set_mempolicy, kMpolPreferred, mask, bits * 16 + 1) == 0;
+    }
+}
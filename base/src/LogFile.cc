@@ -0,0 +1,111 @@
+#include "LogFile.h"
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+static const size_t kIoBufferSize = 64 * 1024;
+
+LogFile::LogFile(const std::string &basename, off_t rollSize, int rollIntervalSeconds)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , rollInterval_(rollIntervalSeconds > 0 ? rollIntervalSeconds : kDefaultRollInterval)
+    , fp_(nullptr)
+    , ioBuffer_(new char[kIoBufferSize])
+    , writtenBytes_(0)
+    , periodStart_(0)
+    , fileCount_(0)
+{
+    rollFile(::time(nullptr));
+}
+
+LogFile::~LogFile()
+{
+    if (fp_)
+    {
+        ::fclose(fp_);
+    }
+}
+
+void LogFile::append(const char *data, size_t len)
+{
+    // 后台线程每次写入一整块缓冲区，在这里检查时间的开销可以忽略
+    time_t now = ::time(nullptr);
+    if (writtenBytes_ >= rollSize_ || now / rollInterval_ * rollInterval_ != periodStart_)
+    {
+        rollFile(now);
+    }
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+
+    size_t written = 0;
+    while (written < len)
+    {
+        size_t n = ::fwrite_unlocked(data + written, 1, len - written, fp_);
+        if (n == 0)
+        {
+            // 日志本身写失败时不能再记日志
+            fprintf(stderr, "LogFile::append() failed %s\n", strerror(ferror(fp_) ? errno : EIO));
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+}
+
+void LogFile::flush()
+{
+    if (fp_)
+    {
+        ::fflush(fp_);
+    }
+}
+
+void LogFile::rollFile(time_t now)
+{
+    std::string filename = logFileName(now);
+    FILE *fp = ::fopen(filename.c_str(), "ae");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "LogFile::rollFile() open %s failed %s\n", filename.c_str(), strerror(errno));
+        // 打不开新文件时继续写旧文件
+        if (fp_ != nullptr)
+        {
+            writtenBytes_ = 0;
+            periodStart_ = now / rollInterval_ * rollInterval_;
+        }
+        return;
+    }
+    if (fp_)
+    {
+        ::fclose(fp_);
+    }
+    fp_ = fp;
+    ::setbuffer(fp_, ioBuffer_.get(), kIoBufferSize);
+    writtenBytes_ = 0;
+    periodStart_ = now / rollInterval_ * rollInterval_;
+    ++fileCount_;
+}
+
+std::string LogFile::logFileName(time_t now) const
+{
+    std::string filename(basename_);
+
+    char timebuf[32];
+    struct tm tm;
+    ::localtime_r(&now, &tm);
+    strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256] = "unknownhost";
+    ::gethostname(hostname, sizeof hostname - 1);
+    filename += hostname;
+
+    // 同一秒内滚动多次时（rollSize很小）用文件序号区分
+    char pidbuf[48];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.%d.log", ::getpid(), fileCount_);
+    filename += pidbuf;
+    return filename;
+}
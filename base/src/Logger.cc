@@ -1,7 +1,51 @@
 #include "Logger.h"
 #include "Timestamp.h"
 
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 
+static void defaultOutput(const char *msg, size_t len)
+{
+    ::fwrite(msg, 1, len, stdout);
+}
+
+static void defaultFlush()
+{
+    ::fflush(stdout);
+}
+
+static int initLogLevel()
+{
+    const char *level = ::getenv("MUDUO_LOG_LEVEL");
+    if (level == nullptr)
+    {
+        return DEBUG;
+    }
+    if (::strcasecmp(level, "INFO") == 0)
+    {
+        return INFO;
+    }
+    if (::strcasecmp(level, "ERROR") == 0)
+    {
+        return ERROR;
+    }
+    if (::strcasecmp(level, "FATAL") == 0)
+    {
+        return FATAL;
+    }
+    return DEBUG;
+}
+
+std::atomic_int Logger::threshold_(initLogLevel());
+
+Logger::Logger()
+    : output_(defaultOutput)
+    , flush_(defaultFlush)
+{
+}
 
 // 获取日志的唯一实例（单例模式）
 Logger& Logger::instance() 
@@ -10,34 +54,66 @@ Logger& Logger::instance()
     return logger;
 }
 
-// 设置日志级别
-void Logger::setLogLevel(int Level) 
+void Logger::setOutput(OutputFunc out)
 {
-    logLevel_ = Level;
+    output_ = std::move(out);
+}
+
+void Logger::setFlush(FlushFunc flush)
+{
+    flush_ = std::move(flush);
+}
+
+void Logger::setUrgentOutput(OutputFunc out)
+{
+    urgentOutput_ = std::move(out);
 }
 
 // 写日志 [级别信息] [time] : [msg]
-void Logger::log(std::string msg) 
+void Logger::log(int level, const char *fmt, ...)
 {   
-    // 打印消息级别
-    switch (logLevel_)
-    {
-        case INFO:
-            std::cout << "[INFO]";
-            break;
-        case ERROR:
-            std::cout << "[ERROR]";
-            break;
-        case FATAL:
-            std::cout << "[FATAL]";
-            break;
-        case DEBUG:
-            std::cout << "[DEBUG]";
-            break;
-        default:
-            break;
-    }
-
-    // 打印时间和消息
-    std::cout << Timestamp::now().toString() << " : " << msg << std::endl;
+    static const char *kLevelNames[] = {"[DEBUG]", "[INFO]", "[ERROR]", "[FATAL]"};
+
+    // 级别和时间作为前缀，消息直接格式化在后面，整行一次输出，多个线程的日志不会交错
+    char buf[1024];
+    int len = 0;
+    if (level >= DEBUG && level <= FATAL)
+    {
+        size_t n = ::strlen(kLevelNames[level]);
+        ::memcpy(buf, kLevelNames[level], n);
+        len = static_cast<int>(n);
+        // 同一秒内的日志只格式化微秒
+        len += Timestamp::now().formatTo(buf + len, sizeof buf - len);
+        ::memcpy(buf + len, " : ", 3);
+        len += 3;
+    }
+
+    // 留一个字节给换行，超长的消息截断
+    int avail = static_cast<int>(sizeof buf) - len - 1;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + len, avail, fmt, args);
+    va_end(args);
+    if (n > 0)
+    {
+        len += n < avail ? n : avail - 1;
+    }
+    buf[len++] = '\n';
+
+    if (level == FATAL)
+    {
+        if (urgentOutput_)
+        {
+            urgentOutput_(buf, len);
+        }
+        else
+        {
+            output_(buf, len);
+        }
+        flush_();
+    }
+    else
+    {
+        output_(buf, len);
+    }
 }
@@ -1,27 +1,211 @@
 #include "Timestamp.h"
 
+#include <atomic>
+#include <fstream>
+#include <mutex>
 #include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MUDUO_HAVE_TSC 1
+#endif
+
+static std::atomic_int g_clockSource(Timestamp::kSystemClock);
+
+// 库不会被dlopen，用initial-exec模型访问线程局部变量，不需要调用__tls_get_addr
+#define MUDUO_TLS_IE __attribute__((tls_model("initial-exec")))
+
+#ifdef MUDUO_HAVE_TSC
+// 校准的结果，切换到kTscClock之前写好，之后只读
+static double g_microsPerTick = 0;
+static uint64_t g_reanchorTicks = 0;    // 一秒对应的tick数
+
+// 每个线程的对齐点：对齐时的TSC和对应的时间，以及本对齐周期内返回过的最大时间
+// 只在一个对齐周期内保证不倒退；重新对齐时直接跟随CLOCK_REALTIME，墙上时间被往回调了也会跟着回退，
+// 否则时间会一直停在调整之前的值上，定时器永远到不了期
+static __thread uint64_t t_anchorTicks MUDUO_TLS_IE = 0;
+static __thread int64_t t_anchorMicros MUDUO_TLS_IE = 0;
+static __thread int64_t t_lastMicros MUDUO_TLS_IE = 0;
+
+static int64_t systemMicros()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
+
+static int64_t tscMicros()
+{
+    uint64_t ticks = __rdtsc();
+    uint64_t delta = ticks - t_anchorTicks;
+    int64_t micros;
+    if (__builtin_expect(t_anchorTicks == 0 || delta > g_reanchorTicks, 0))
+    {
+        // 频率的误差会累积，每秒对齐一次
+        t_anchorMicros = systemMicros();
+        t_anchorTicks = __rdtsc();
+        micros = t_anchorMicros;
+    }
+    else
+    {
+        micros = t_anchorMicros + static_cast<int64_t>(delta * g_microsPerTick);
+        // 线程迁移到另一个核上时TSC可能有很小的偏差，周期内不让时间倒退
+        if (micros < t_lastMicros)
+        {
+            micros = t_lastMicros;
+        }
+    }
+    t_lastMicros = micros;
+    return micros;
+}
+
+static bool invariantTsc()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line))
+    {
+        if (line.compare(0, 5, "flags") == 0)
+        {
+            return line.find(" constant_tsc") != std::string::npos
+                && line.find(" nonstop_tsc") != std::string::npos;
+        }
+    }
+    return false;
+}
+
+static bool calibrateTsc()
+{
+    static std::once_flag once;
+    static bool ok = false;
+    std::call_once(once, []() {
+        if (!invariantTsc())
+        {
+            return;
+        }
+        struct timespec ts0, ts1;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts0);
+        uint64_t ticks0 = __rdtsc();
+        ::usleep(10 * 1000);
+        ::clock_gettime(CLOCK_MONOTONIC, &ts1);
+        uint64_t ticks1 = __rdtsc();
+        double micros = (ts1.tv_sec - ts0.tv_sec) * 1e6 + (ts1.tv_nsec - ts0.tv_nsec) / 1e3;
+        if (micros <= 0 || ticks1 <= ticks0)
+        {
+            return;
+        }
+        g_microsPerTick = micros / static_cast<double>(ticks1 - ticks0);
+        g_reanchorTicks = static_cast<uint64_t>(1e6 / g_microsPerTick);
+        ok = true;
+    });
+    return ok;
+}
+#endif
 
 Timestamp::Timestamp() : microSecondsSinceEpoch_(0) {}
 
 Timestamp::Timestamp(int64_t microSecondsSinceEpoch) : microSecondsSinceEpoch_(microSecondsSinceEpoch) {}
 
+// 定时器需要微秒精度，这里使用gettimeofday而不是time(NULL)
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL));
+#ifdef MUDUO_HAVE_TSC
+    if (g_clockSource.load(std::memory_order_acquire) == kTscClock)
+    {
+        return Timestamp(tscMicros());
+    }
+#endif
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return Timestamp(static_cast<int64_t>(tv.tv_sec) * kMicroSecondsPerSecond + tv.tv_usec);
+}
+
+Timestamp::ClockSource Timestamp::setClockSource(ClockSource source)
+{
+#ifdef MUDUO_HAVE_TSC
+    if (source == kTscClock && !calibrateTsc())
+    {
+        source = kSystemClock;
+    }
+#else
+    source = kSystemClock;
+#endif
+    g_clockSource.store(source, std::memory_order_release);
+    return source;
+}
+
+Timestamp::ClockSource Timestamp::clockSource()
+{
+    return static_cast<ClockSource>(g_clockSource.load(std::memory_order_relaxed));
+}
+
+// 每个线程缓存的"年/月/日 时:分:秒"
+static __thread int64_t t_cachedSeconds MUDUO_TLS_IE = -1;
+static __thread char t_cachedTime[32] MUDUO_TLS_IE;
+static __thread int t_cachedTimeLen MUDUO_TLS_IE = 0;
+
+int Timestamp::formatTo(char *buf, size_t len, bool showMicroseconds) const
+{
+    int64_t seconds = microSecondsSinceEpoch_ / kMicroSecondsPerSecond;
+    if (seconds != t_cachedSeconds)
+    {
+        time_t t = static_cast<time_t>(seconds);
+        struct tm tm_time;
+        ::localtime_r(&t, &tm_time);
+        t_cachedTimeLen = snprintf(t_cachedTime, sizeof t_cachedTime,
+            "%4d/%02d/%02d %02d:%02d:%02d",
+            tm_time.tm_year + 1900,
+            tm_time.tm_mon + 1,
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec);
+        t_cachedSeconds = seconds;
+    }
+
+    size_t n = static_cast<size_t>(t_cachedTimeLen);
+    if (len <= n + (showMicroseconds ? 7 : 0))
+    {
+        // buf太小，截断
+        if (len == 0)
+        {
+            return 0;
+        }
+        n = n < len - 1 ? n : len - 1;
+        ::memcpy(buf, t_cachedTime, n);
+        buf[n] = '\0';
+        return static_cast<int>(n);
+    }
+    ::memcpy(buf, t_cachedTime, n);
+    if (showMicroseconds)
+    {
+        // 只重写微秒部分
+        int micros = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
+        buf[n++] = '.';
+        for (int i = 5; i >= 0; --i)
+        {
+            buf[n + i] = static_cast<char>('0' + micros % 10);
+            micros /= 10;
+        }
+        n += 6;
+    }
+    buf[n] = '\0';
+    return static_cast<int>(n);
 }
 
 std::string Timestamp::toString() const
 {
-    char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, 
-        "%4d/%02d/%02d %02d:%02d:%02d", 
-        tm_time->tm_year + 1900,
-        tm_time->tm_mon + 1,
-        tm_time->tm_mday,
-        tm_time->tm_hour,
-        tm_time->tm_min,
-        tm_time->tm_sec);
-    return buf;
-}
\ No newline at end of file
+    char buf[64];
+    int n = formatTo(buf, sizeof buf, false);
+    return std::string(buf, n);
+}
+
+std::string Timestamp::toFormattedString(bool showMicroseconds) const
+{
+    char buf[64];
+    int n = formatTo(buf, sizeof buf, showMicroseconds);
+    return std::string(buf, n);
+}
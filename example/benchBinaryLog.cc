@@ -0,0 +1,77 @@
+#include <myMuduo/BinaryLog.h>
+#include <myMuduo/Logger.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 二进制日志前端开销的压测：多个线程同时写LOG_BINARY，统计每次调用的耗时和丢弃的条数
+ * 模式0写二进制文件（之后用bin/decodeBinaryLog解码），模式1在后台线程格式化成文本交给Logger
+ * 用法：./benchBinaryLog [线程数] [每个线程的日志条数] [模式] [每个线程的环形缓冲区字节数] [文件]
+ * 压测结果输出到stderr
+ */
+
+int main(int argc, char *argv[])
+{
+    using Clock = std::chrono::steady_clock;
+
+    int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+    int lines = argc > 2 ? atoi(argv[2]) : 1000000;
+    int mode = argc > 3 ? atoi(argv[3]) : 0;
+    size_t ringBytes = argc > 4 ? atol(argv[4]) : 4 << 20;
+    std::string path = argc > 5 ? argv[5] : "/tmp/benchBinaryLog.bin";
+
+    BinaryLog::instance().start(path, mode == 1 ? BinaryLog::kText : BinaryLog::kBinaryFile, ringBytes, 1);
+
+    std::vector<std::vector<double>> latencies(numThreads);
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads.emplace_back([i, lines, &latencies]() {
+            std::vector<double> &lat = latencies[i];
+            lat.reserve(lines / 16 + 1);
+            std::string name = "conn-" + std::to_string(i);
+            for (int j = 0; j < lines; ++j)
+            {
+                // 每16次取一次时间，避免时钟本身的开销盖过被测的调用
+                if ((j & 15) == 0)
+                {
+                    auto t0 = Clock::now();
+                    LOG_BINARY("%s recv %d bytes fd=%d ratio=%.3f", name.c_str(), j, j & 1023, j / 7.0);
+                    lat.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+                }
+                else
+                {
+                    LOG_BINARY("%s recv %d bytes fd=%d ratio=%.3f", name.c_str(), j, j & 1023, j / 7.0);
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    double frontSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    BinaryLog::instance().stop();
+
+    std::vector<double> all;
+    for (std::vector<double> &lat : latencies)
+    {
+        all.insert(all.end(), lat.begin(), lat.end());
+    }
+    std::sort(all.begin(), all.end());
+    int64_t total = static_cast<int64_t>(numThreads) * lines;
+    fprintf(stderr, "mode=%s threads=%d lines=%d ring=%zu\n", mode ? "text" : "binary", numThreads, lines, ringBytes);
+    fprintf(stderr, "front end %.3f s (%.0f lines/s, %.1f ns/line)\n",
+            frontSeconds, total / frontSeconds, frontSeconds * 1e9 / total);
+    fprintf(stderr, "sampled per call ns (includes one clock read): p50=%.0f p99=%.0f max=%.0f\n",
+            all[all.size() / 2], all[all.size() * 99 / 100], all.back());
+    fprintf(stderr, "dropped=%llu\n", (unsigned long long)BinaryLog::instance().droppedRecords());
+    return 0;
+}
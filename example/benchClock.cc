@@ -0,0 +1,108 @@
+#include <myMuduo/Timestamp.h>
+#include <myMuduo/EventLoop.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <chrono>
+#include <string>
+
+/**
+ * 时钟和时间格式化的微基准：对比原来的实现（gettimeofday + 每次localtime格式化）和
+ * TSC时钟源、EventLoop缓存的时间、缓存秒数的格式化
+ * 用法：./benchClock [次数]
+ * 压测结果输出到stderr
+ */
+
+static volatile int64_t g_sink = 0;
+
+// 原来的Timestamp::toString：每次都调用localtime和snprintf
+static std::string legacyToString(Timestamp t)
+{
+    char buf[128] = {0};
+    time_t seconds = static_cast<time_t>(t.microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond);
+    tm *tm_time = localtime(&seconds);
+    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
+             tm_time->tm_year + 1900, tm_time->tm_mon + 1, tm_time->tm_mday,
+             tm_time->tm_hour, tm_time->tm_min, tm_time->tm_sec);
+    return buf;
+}
+
+template <typename F>
+static void measure(const char *name, int iterations, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        f();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%-40s %8.1f ns/op\n", name, ns / iterations);
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 5000000;
+
+    Timestamp::setClockSource(Timestamp::kSystemClock);
+    measure("Timestamp::now() gettimeofday", iterations, []() {
+        g_sink += Timestamp::now().microSecondsSinceEpoch();
+    });
+
+    bool tsc = Timestamp::setClockSource(Timestamp::kTscClock) == Timestamp::kTscClock;
+    if (tsc)
+    {
+        measure("Timestamp::now() tsc", iterations, []() {
+            g_sink += Timestamp::now().microSecondsSinceEpoch();
+        });
+        // TSC时钟和系统时钟的偏差
+        int64_t maxDiff = 0;
+        for (int i = 0; i < 2000; ++i)
+        {
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            int64_t system = static_cast<int64_t>(tv.tv_sec) * Timestamp::kMicroSecondsPerSecond + tv.tv_usec;
+            int64_t diff = Timestamp::now().microSecondsSinceEpoch() - system;
+            maxDiff = std::max(maxDiff, diff < 0 ? -diff : diff);
+            if (i % 200 == 0)
+            {
+                struct timespec ts = {0, 1000 * 1000};
+                nanosleep(&ts, NULL);
+            }
+        }
+        fprintf(stderr, "%-40s %8lld us\n", "tsc vs gettimeofday max diff", (long long)maxDiff);
+    }
+    else
+    {
+        fprintf(stderr, "invariant TSC not available, skipping tsc clock\n");
+    }
+    Timestamp::setClockSource(Timestamp::kSystemClock);
+
+    EventLoop loop(Poller::kEpoll);
+    loop.queueInLoop([&loop, iterations]() {
+        measure("EventLoop::now() cached", iterations, [&loop]() {
+            g_sink += loop.now().microSecondsSinceEpoch();
+        });
+        loop.quit();
+    });
+    loop.loop();
+
+    Timestamp t = Timestamp::now();
+    int formatIterations = iterations / 5;
+    measure("legacy toString (localtime each call)", formatIterations, [&t]() {
+        g_sink += legacyToString(t).size();
+        t = Timestamp(t.microSecondsSinceEpoch() + 1);
+    });
+    measure("toString (cached seconds)", formatIterations, [&t]() {
+        g_sink += t.toString().size();
+        t = Timestamp(t.microSecondsSinceEpoch() + 1);
+    });
+    char buf[64];
+    measure("formatTo with micros (cached seconds)", formatIterations, [&t, &buf]() {
+        g_sink += t.formatTo(buf, sizeof buf);
+        t = Timestamp(t.microSecondsSinceEpoch() + 1);
+    });
+    fprintf(stderr, "sample: %s\n", Timestamp::now().toFormattedString().c_str());
+    return 0;
+}
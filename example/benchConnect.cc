@@ -0,0 +1,159 @@
+#include <myMuduo/TcpServer.h>
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/Logger.h>
+
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 建连风暴压测：多个客户端线程不停地建立连接，服务端在onConnection中发送1个字节，
+ * 客户端收到后用RST关闭（SO_LINGER 0，不留TIME_WAIT），统计每秒完成的连接数和各个loop分到的连接数
+ * 每个客户端线程一次发起burst个connect再逐个等待，burst较大时服务端的accept队列里会积压多个连接
+ * 用法：./benchConnect [连接总数] [客户端线程数] [IO线程数] [接收模式] [burst] [服务端每次accept的上限]
+ * 接收模式：0 mainLoop接收后轮询分发，1 SO_REUSEPORT分片，2 EPOLLEXCLUSIVE共享监听
+ * 压测结果输出到stderr，库日志输出到stdout，可以把stdout重定向到/dev/null
+ */
+
+static const uint16_t kPort = 9983;
+
+static std::mutex g_mutex;
+static std::map<EventLoop*, int> g_perLoop;    // 每个loop建立的连接数
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        {
+            std::unique_lock<std::mutex> lock(g_mutex);
+            ++g_perLoop[conn->getLoop()];
+        }
+        conn->send("x");
+    }
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    buf->retrieveAll();
+}
+
+static void connectLoop(int count, int burst, std::atomic<int> *failures)
+{
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::vector<int> fds(burst);
+    for (int i = 0; i < count; i += burst)
+    {
+        // 三次握手由内核完成，connect返回时连接已经在服务端的accept队列里了
+        for (int &fd : fds)
+        {
+            fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (::connect(fd, (struct sockaddr*)&addr, sizeof addr) < 0)
+            {
+                ::close(fd);
+                fd = -1;
+                ++*failures;
+            }
+        }
+        for (int fd : fds)
+        {
+            if (fd < 0)
+            {
+                continue;
+            }
+            char c;
+            if (::read(fd, &c, 1) != 1)
+            {
+                ++*failures;
+            }
+            struct linger lg = {1, 0};
+            ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+            ::close(fd);
+        }
+    }
+}
+
+static void runClient(EventLoop *serverLoop, int total, int numClients, int mode, int burst)
+{
+    static const char *kModes[] = {"baseLoop", "reuseport", "exclusive"};
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numClients; ++i)
+    {
+        threads.emplace_back(connectLoop, total / numClients, burst, &failures);
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    int done = (total / numClients + burst - 1) / burst * burst * numClients;
+    fprintf(stderr, "mode=%s connections=%d clients=%d burst=%d\n", kModes[mode], done, numClients, burst);
+    fprintf(stderr, "%.3f s, %.0f connections/s, failures=%d\n", seconds, done / seconds, failures.load());
+    std::unique_lock<std::mutex> lock(g_mutex);
+    fprintf(stderr, "per loop:");
+    for (auto &item : g_perLoop)
+    {
+        fprintf(stderr, " %d", item.second);
+    }
+    fprintf(stderr, "\n");
+
+    serverLoop->runAfter(0.1, [serverLoop]() { serverLoop->quit(); });
+}
+
+int main(int argc, char *argv[])
+{
+    int total = argc > 1 ? atoi(argv[1]) : 20000;
+    int numClients = argc > 2 ? atoi(argv[2]) : 4;
+    int numThreads = argc > 3 ? atoi(argv[3]) : 4;
+    int mode = argc > 4 ? atoi(argv[4]) : 0;
+    int burst = argc > 5 ? atoi(argv[5]) : 1;
+    int acceptBatch = argc > 6 ? atoi(argv[6]) : Acceptor::kDefaultAcceptBatch;
+    if (mode < 0 || mode > 2)
+    {
+        mode = 0;
+    }
+    if (burst < 1)
+    {
+        burst = 1;
+    }
+
+    EventLoop loop(Poller::kEpoll);
+    TcpServer server(&loop, InetAddress(kPort), "benchConnect", TcpServer::KReusePost);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.setThreadNum(numThreads);
+    server.setAcceptBatch(acceptBatch);
+    server.setShardedAccept(mode == 1);
+    if (mode == 2)
+    {
+        server.setSharedAccept(true);
+    }
+    server.start();
+
+    std::thread client(runClient, &loop, total, numClients, mode, burst);
+    loop.loop();
+    client.join();
+    return 0;
+}
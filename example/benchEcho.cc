@@ -0,0 +1,151 @@
+#include <myMuduo/TcpServer.h>
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/Logger.h>
+
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 回声服务器的乒乓压测：客户端线程建立多条连接，每条连接发送一个消息并等待完整回声后再发下一个
+ * 用法：./benchEcho [连接数] [每条连接的往返次数] [消息大小] [IO线程数] [完成模式0/1]
+ * 对比后端：MUDUO_USE_IO_URING=1 ./benchEcho ... 与 ./benchEcho ...
+ * 完成模式（recv/send也走io_uring）需要同时设置MUDUO_USE_IO_URING=1
+ * 压测结果输出到stderr，库日志输出到stdout，可以把stdout重定向到/dev/null
+ */
+
+static const uint16_t kPort = 9981;
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf->retrieveAllAsString());
+}
+
+struct Client
+{
+    int fd;
+    int rounds;         // 已完成的往返次数
+    size_t received;    // 本轮已经收到的字节数
+};
+
+static void runClient(EventLoop *serverLoop, int numConns, int rounds, size_t msgSize, bool completion)
+{
+    std::vector<Client> clients(numConns);
+    std::vector<struct pollfd> pfds(numConns);
+    std::string message(msgSize, 'x');
+    std::vector<char> buf(msgSize);
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (int i = 0; i < numConns; ++i)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (::connect(fd, (struct sockaddr*)&addr, sizeof addr) < 0)
+        {
+            fprintf(stderr, "connect error: %s\n", strerror(errno));
+            exit(1);
+        }
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+        clients[i] = Client{fd, 0, 0};
+        pfds[i].fd = fd;
+        pfds[i].events = POLLIN;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (Client &c : clients)
+    {
+        ::write(c.fd, message.data(), message.size());
+    }
+
+    int finished = 0;
+    while (finished < numConns)
+    {
+        ::poll(pfds.data(), pfds.size(), -1);
+        for (int i = 0; i < numConns; ++i)
+        {
+            if (!(pfds[i].revents & POLLIN))
+            {
+                continue;
+            }
+            Client &c = clients[i];
+            ssize_t n = ::read(c.fd, buf.data(), msgSize - c.received);
+            if (n <= 0)
+            {
+                fprintf(stderr, "read error: %s\n", n == 0 ? "peer closed" : strerror(errno));
+                exit(1);
+            }
+            c.received += n;
+            if (c.received < msgSize)
+            {
+                continue;
+            }
+            c.received = 0;
+            if (++c.rounds < rounds)
+            {
+                ::write(c.fd, message.data(), message.size());
+            }
+            else
+            {
+                pfds[i].fd = -1;    // poll会忽略负的fd
+                ++finished;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    int64_t total = static_cast<int64_t>(numConns) * rounds;
+    fprintf(stderr, "backend=%s completion=%d conns=%d rounds=%d msgSize=%zu\n",
+            ::getenv("MUDUO_USE_IO_URING") ? "io_uring" : "epoll",
+            completion ? 1 : 0, numConns, rounds, msgSize);
+    fprintf(stderr, "%.3f s, %.0f round trips/s, %.2f us per round trip\n",
+            seconds, total / seconds, seconds * 1e6 / total);
+
+    for (Client &c : clients)
+    {
+        ::close(c.fd);
+    }
+    serverLoop->runAfter(0.1, [serverLoop]() { serverLoop->quit(); });
+}
+
+int main(int argc, char *argv[])
+{
+    int numConns = argc > 1 ? atoi(argv[1]) : 100;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10000;
+    size_t msgSize = argc > 3 ? atoi(argv[3]) : 64;
+    int numThreads = argc > 4 ? atoi(argv[4]) : 0;
+    bool completion = argc > 5 ? atoi(argv[5]) != 0 : false;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "benchEcho", TcpServer::KReusePost);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.setThreadNum(numThreads);
+    server.setCompletionMode(completion);
+    server.start();
+
+    std::thread client(runClient, &loop, numConns, rounds, msgSize, completion);
+    loop.loop();
+    client.join();
+    return 0;
+}
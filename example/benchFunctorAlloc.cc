@@ -0,0 +1,104 @@
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/EventLoopThread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+/**
+ * 统计每个任务的堆分配次数
+ * 替换全局的operator new，对比std::function和EventLoop::Functor包装同样的闭包，
+ * 以及跨线程queueInLoop完整一次投递的分配次数
+ * 用法：./benchFunctorAlloc [任务数]
+ */
+
+static std::atomic<long> g_allocs(0);
+
+void* operator new(size_t size)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+struct Session : public std::enable_shared_from_this<Session>
+{
+    void onWrite(const std::string &msg) { bytes += msg.size(); }
+    void onTick(int n) { bytes += n; }
+    size_t bytes = 0;
+};
+
+template <typename Function, typename MakeClosure>
+double allocsPerTask(int n, MakeClosure make)
+{
+    long before = g_allocs.load();
+    for (int i = 0; i < n; ++i)
+    {
+        Function f(make());
+        f();
+    }
+    return static_cast<double>(g_allocs.load() - before) / n;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    std::shared_ptr<Session> session(new Session);
+    std::string msg("hello");   // SSO，拷贝本身不分配
+
+    // 和TcpConnection::send跨线程投递的闭包形状一样：成员函数指针 + shared_ptr + string
+    auto sendLike = [&]() { return std::bind(&Session::onWrite, session, msg); };
+    auto tickLike = [&]() { return std::bind(&Session::onTick, session, 1); };
+
+    printf("closure sizes: send-like=%zu tick-like=%zu inline capacity=%zu\n",
+        sizeof(sendLike()), sizeof(tickLike()), EventLoop::kFunctorInlineSize);
+    printf("std::function        send-like: %.2f allocs/task\n",
+        allocsPerTask<std::function<void()>>(n, sendLike));
+    printf("EventLoop::Functor   send-like: %.2f allocs/task\n",
+        allocsPerTask<EventLoop::Functor>(n, sendLike));
+    printf("std::function        tick-like: %.2f allocs/task\n",
+        allocsPerTask<std::function<void()>>(n, tickLike));
+    printf("EventLoop::Functor   tick-like: %.2f allocs/task\n",
+        allocsPerTask<EventLoop::Functor>(n, tickLike));
+
+    // 跨线程投递：分批投递并等待执行完，稳定之后节点都从空闲链表复用
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    std::atomic<int> done(0);
+    const int kBatch = 1000;
+    long before = 0;
+    for (int round = 0; round <= n / kBatch; ++round)
+    {
+        if (round == 1)
+        {
+            before = g_allocs.load();   // 第0轮预热节点缓存
+        }
+        for (int i = 0; i < kBatch; ++i)
+        {
+            loop->queueInLoop(std::bind(&Session::onTick, session, 1));
+        }
+        loop->queueInLoop([&done]() { done.fetch_add(1); });
+        while (done.load() != round + 1)
+        {
+            std::this_thread::yield();
+        }
+    }
+    long tasks = static_cast<long>(n / kBatch) * (kBatch + 1);
+    printf("queueInLoop round trip        : %.3f allocs/task (%ld tasks)\n",
+        static_cast<double>(g_allocs.load() - before) / tasks, tasks);
+    return 0;
+}
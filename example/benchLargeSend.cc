@@ -0,0 +1,117 @@
+#include <myMuduo/TcpServer.h>
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/Logger.h>
+
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 大响应的发送压测：客户端每发一个字节的请求，服务端回复payloadMB大小的响应，客户端读完整个响应再发下一个
+ * 内核发送缓冲区放不下，大部分数据要先放进outputBuffer_，再由handleWrite分多次写出去
+ * 模式0用send(std::string)拷贝进发送缓冲区，模式1用send(shared_ptr)把响应作为外部分片挂进发送缓冲区，不拷贝
+ * 用法：./benchLargeSend [payloadMB] [请求次数] [模式]
+ * 压测结果输出到stderr，库日志输出到stdout，可以把stdout重定向到/dev/null
+ */
+
+static const uint16_t kPort = 9988;
+
+static std::shared_ptr<const std::string> g_payload;
+static int g_mode = 0;
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    size_t requests = buf->readableBytes();
+    buf->retrieveAll();
+    for (size_t i = 0; i < requests; ++i)
+    {
+        if (g_mode == 1)
+        {
+            conn->send(g_payload);
+        }
+        else
+        {
+            conn->send(*g_payload);
+        }
+    }
+}
+
+static void runClient(EventLoop *serverLoop, int rounds)
+{
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof addr) < 0)
+    {
+        fprintf(stderr, "connect error: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    std::vector<char> buf(256 * 1024);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        ::write(fd, "r", 1);
+        size_t received = 0;
+        while (received < g_payload->size())
+        {
+            ssize_t n = ::read(fd, buf.data(), buf.size());
+            if (n <= 0)
+            {
+                fprintf(stderr, "read error\n");
+                exit(1);
+            }
+            received += n;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    double mb = static_cast<double>(g_payload->size()) * rounds / (1 << 20);
+    fprintf(stderr, "mode=%s payload=%zu MB rounds=%d\n", g_mode ? "slice" : "copy",
+            g_payload->size() >> 20, rounds);
+    fprintf(stderr, "%.3f s, %.0f MB/s, %.1f ms per response, maxrss=%ld MB\n",
+            seconds, mb / seconds, seconds * 1000 / rounds, usage.ru_maxrss / 1024);
+
+    ::close(fd);
+    serverLoop->runAfter(0.2, [serverLoop]() { serverLoop->quit(); });
+}
+
+int main(int argc, char *argv[])
+{
+    size_t payloadMB = argc > 1 ? atoi(argv[1]) : 50;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    g_mode = argc > 3 ? atoi(argv[3]) : 0;
+    g_payload = std::make_shared<const std::string>(payloadMB << 20, 'x');
+
+    EventLoop loop(Poller::kEpoll);
+    TcpServer server(&loop, InetAddress(kPort), "benchLargeSend");
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::thread client(runClient, &loop, rounds);
+    loop.loop();
+    client.join();
+    return 0;
+}
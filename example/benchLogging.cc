@@ -0,0 +1,110 @@
+#include <myMuduo/Logger.h>
+#include <myMuduo/AsyncLogging.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 日志前端开销的压测：多个线程同时写LOG_INFO，统计每次调用的耗时
+ * 模式0同步写文件，每行fflush（和原来std::endl的行为一样）；模式1使用AsyncLogging写滚动文件；
+ * 模式2把运行期阈值设为ERROR，测量被关闭的LOG_INFO的开销
+ * 用法：./benchLogging [线程数] [每个线程的日志条数] [模式] [日志目录]
+ * 压测结果输出到stderr
+ */
+
+static FILE *g_file = nullptr;
+
+static void syncOutput(const char *msg, size_t len)
+{
+    ::fwrite(msg, 1, len, g_file);
+    ::fflush(g_file);
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace std::placeholders;
+    using Clock = std::chrono::steady_clock;
+
+    int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+    int lines = argc > 2 ? atoi(argv[2]) : 200000;
+    int mode = argc > 3 ? atoi(argv[3]) : 1;
+    if (mode < 0 || mode > 2)
+    {
+        mode = 1;
+    }
+    std::string dir = argc > 4 ? argv[4] : "/tmp";
+
+    std::string basename = dir + "/benchLogging";
+    AsyncLogging async(basename, 64 * 1024 * 1024);
+    if (mode == 0)
+    {
+        g_file = ::fopen((basename + ".sync.log").c_str(), "w");
+        Logger::instance().setOutput(syncOutput);
+    }
+    else if (mode == 2)
+    {
+        Logger::setLogLevel(ERROR);
+    }
+    else
+    {
+        async.start();
+        Logger::instance().setOutput(std::bind(&AsyncLogging::append, &async, _1, _2));
+        Logger::instance().setUrgentOutput(std::bind(&AsyncLogging::appendUrgent, &async, _1, _2));
+        Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &async));
+    }
+
+    std::vector<std::vector<double>> latencies(numThreads);
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads.emplace_back([i, lines, &latencies]() {
+            std::vector<double> &lat = latencies[i];
+            lat.reserve(lines);
+            for (int j = 0; j < lines; ++j)
+            {
+                auto t0 = Clock::now();
+                LOG_INFO("thread %d line %d fd=%d events=%d some payload to make the line realistic", i, j, j & 1023, 3);
+                lat.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+            }
+        });
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    double frontSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (mode == 0)
+    {
+        ::fclose(g_file);
+    }
+    else if (mode == 1)
+    {
+        async.stop();
+    }
+    double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (std::vector<double> &lat : latencies)
+    {
+        all.insert(all.end(), lat.begin(), lat.end());
+    }
+    std::sort(all.begin(), all.end());
+    int64_t total = static_cast<int64_t>(numThreads) * lines;
+    static const char *kModes[] = {"sync", "async", "disabled"};
+    fprintf(stderr, "mode=%s threads=%d lines=%d\n", kModes[mode], numThreads, lines);
+    fprintf(stderr, "front end %.3f s (%.0f lines/s), until on disk %.3f s\n",
+            frontSeconds, total / frontSeconds, totalSeconds);
+    fprintf(stderr, "per call ns: p50=%.0f p99=%.0f p99.9=%.0f max=%.0f\n",
+            all[all.size() / 2], all[all.size() * 99 / 100], all[all.size() * 999 / 1000], all.back());
+    if (mode == 1)
+    {
+        fprintf(stderr, "dropped=%llu\n", (unsigned long long)async.droppedMessages());
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <myMuduo/TcpServer.h>
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/Logger.h>
+
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 流水线回声压测，统计服务端（loop线程）的系统调用次数，对比水平触发和边沿触发
+ * 客户端每轮在每条连接上一次写入depth个消息，再等待全部回声，
+ * 回声数据量大时服务端的发送缓冲区会写满，水平触发需要反复epoll_ctl打开/关闭EPOLLOUT
+ * 同时输出poller合并修改省掉的epoll_ctl次数
+ * 用法：./benchPipeline [连接数] [轮数] [流水线深度] [消息大小] [边沿触发0/1]
+ * 压测结果输出到stderr，库日志输出到stdout，可以把stdout重定向到/dev/null
+ */
+
+static const uint16_t kPort = 9982;
+
+// 在可执行文件中定义同名函数，libmyMuduo.so中的调用会先解析到这里，统计之后再直接发起系统调用
+// 只统计设置了t_counting的线程（服务端loop线程）
+static thread_local bool t_counting = false;
+static std::atomic<int64_t> g_epollWait(0);
+static std::atomic<int64_t> g_epollCtl(0);
+static std::atomic<int64_t> g_reads(0);
+static std::atomic<int64_t> g_writes(0);
+
+static void count(std::atomic<int64_t> &counter)
+{
+    if (t_counting)
+    {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    count(g_epollWait);
+    return static_cast<int>(::syscall(SYS_epoll_pwait, epfd, events, maxevents, timeout, nullptr, 8));
+}
+
+extern "C" int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    count(g_epollCtl);
+    return static_cast<int>(::syscall(SYS_epoll_ctl, epfd, op, fd, event));
+}
+
+extern "C" ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    count(g_reads);
+    return ::syscall(SYS_readv, fd, iov, iovcnt);
+}
+
+extern "C" ssize_t read(int fd, void *buf, size_t count_)
+{
+    count(g_reads);
+    return ::syscall(SYS_read, fd, buf, count_);
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count_)
+{
+    count(g_writes);
+    return ::syscall(SYS_write, fd, buf, count_);
+}
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf->retrieveAllAsString());
+}
+
+static void runClient(EventLoop *serverLoop, int numConns, int rounds, int depth, size_t msgSize, bool edge)
+{
+    std::vector<int> fds(numConns);
+    std::vector<size_t> received(numConns);
+    std::vector<struct pollfd> pfds(numConns);
+    const size_t burst = depth * msgSize;
+    std::string request(burst, 'x');
+    std::vector<char> buf(64 * 1024);
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (int i = 0; i < numConns; ++i)
+    {
+        fds[i] = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        // 小的接收窗口，让服务端的发送缓冲区容易写满
+        int rcvbuf = 16 * 1024;
+        ::setsockopt(fds[i], SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+        if (::connect(fds[i], (struct sockaddr*)&addr, sizeof addr) < 0)
+        {
+            fprintf(stderr, "connect error: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        // 一次写入depth个消息，写的同时读取回声，避免双方的缓冲区都满了
+        for (int i = 0; i < numConns; ++i)
+        {
+            received[i] = 0;
+            pfds[i].fd = fds[i];
+            pfds[i].events = POLLIN | POLLOUT;
+        }
+        std::vector<size_t> sent(numConns, 0);
+        int finished = 0;
+        while (finished < numConns)
+        {
+            ::poll(pfds.data(), pfds.size(), -1);
+            for (int i = 0; i < numConns; ++i)
+            {
+                if (pfds[i].revents & POLLOUT)
+                {
+                    ssize_t n = ::send(fds[i], request.data() + sent[i], burst - sent[i], MSG_DONTWAIT);
+                    if (n > 0 && (sent[i] += n) == burst)
+                    {
+                        pfds[i].events = POLLIN;
+                    }
+                }
+                if (pfds[i].revents & POLLIN)
+                {
+                    ssize_t n = ::recv(fds[i], buf.data(), buf.size(), MSG_DONTWAIT);
+                    if (n == 0 || (n < 0 && errno != EAGAIN))
+                    {
+                        fprintf(stderr, "recv error: %s\n", n == 0 ? "peer closed" : strerror(errno));
+                        exit(1);
+                    }
+                    if (n > 0 && (received[i] += n) == burst)
+                    {
+                        pfds[i].fd = -1;    // poll会忽略负的fd
+                        ++finished;
+                    }
+                }
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    int64_t messages = static_cast<int64_t>(numConns) * rounds * depth;
+    fprintf(stderr, "mode=%s conns=%d rounds=%d depth=%d msgSize=%zu\n",
+            edge ? "ET" : "LT", numConns, rounds, depth, msgSize);
+    fprintf(stderr, "%.3f s, %.0f msgs/s\n", seconds, messages / seconds);
+    fprintf(stderr, "server syscalls: epoll_wait=%lld epoll_ctl=%lld read=%lld write=%lld total=%lld\n",
+            (long long)g_epollWait.load(), (long long)g_epollCtl.load(),
+            (long long)g_reads.load(), (long long)g_writes.load(),
+            (long long)(g_epollWait + g_epollCtl + g_reads + g_writes));
+    fprintf(stderr, "epoll_ctl saved by coalescing: %llu\n",
+            (unsigned long long)serverLoop->pollerUpdatesSaved());
+
+    for (int fd : fds)
+    {
+        ::close(fd);
+    }
+    serverLoop->runAfter(0.1, [serverLoop]() { serverLoop->quit(); });
+}
+
+int main(int argc, char *argv[])
+{
+    int numConns = argc > 1 ? atoi(argv[1]) : 20;
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    int depth = argc > 3 ? atoi(argv[3]) : 64;
+    size_t msgSize = argc > 4 ? atoi(argv[4]) : 1024;
+    bool edge = argc > 5 ? atoi(argv[5]) != 0 : false;
+
+    EventLoop loop(Poller::kEpoll);
+    TcpServer server(&loop, InetAddress(kPort), "benchPipeline", TcpServer::KReusePost);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.setEdgeTriggered(edge);
+    server.start();
+
+    std::thread client(runClient, &loop, numConns, rounds, depth, msgSize, edge);
+    t_counting = true;
+    loop.loop();
+    client.join();
+    return 0;
+}
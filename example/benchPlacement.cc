@@ -0,0 +1,167 @@
+#include <myMuduo/TcpServer.h>
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/Logger.h>
+
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 连接分配压测：按numThreads个连接一组建立连接，每组只保留第一条（长连接），其余收到问候后立即关闭
+ * 轮询分配时所有长连接都落在同一个subLoop上；之后在长连接上做乒乓，服务端每个消息忙算workUs微秒
+ * 输出每个loop剩下的连接数和乒乓耗时
+ * 用法：./benchPlacement [长连接数] [IO线程数] [策略] [往返次数] [workUs]
+ * 策略：0 轮询，1 最少连接，2 两选一（循环延迟），3 两选一（待执行回调），4 对端IP哈希
+ * 压测结果输出到stderr，库日志输出到stdout，可以把stdout重定向到/dev/null
+ */
+
+static const uint16_t kPort = 9984;
+
+static int g_workUs = 20;
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->send("x");
+    }
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    // 模拟每个请求的计算量
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(g_workUs);
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+    conn->send(buf->retrieveAllAsString());
+}
+
+static int connectOne()
+{
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    char c;
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof addr) < 0 || ::read(fd, &c, 1) != 1)
+    {
+        fprintf(stderr, "connect error: %s\n", strerror(errno));
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    return fd;
+}
+
+static void runClient(EventLoop *serverLoop, TcpServer *server, int numHeavy, int numThreads, int rounds)
+{
+    std::vector<int> heavy;
+    for (int i = 0; i < numHeavy; ++i)
+    {
+        heavy.push_back(connectOne());
+        for (int j = 1; j < numThreads; ++j)
+        {
+            ::close(connectOne());
+        }
+    }
+    // 等服务端处理完短连接的关闭
+    ::usleep(200 * 1000);
+
+    // 乒乓：所有长连接同时发送，收到回声后再发下一个
+    std::vector<struct pollfd> pfds(heavy.size());
+    std::vector<int> done(heavy.size(), 0);
+    char buf[64];
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < heavy.size(); ++i)
+    {
+        pfds[i].fd = heavy[i];
+        pfds[i].events = POLLIN;
+        ::write(heavy[i], "p", 1);
+    }
+    size_t finished = 0;
+    while (finished < heavy.size())
+    {
+        ::poll(pfds.data(), pfds.size(), -1);
+        for (size_t i = 0; i < heavy.size(); ++i)
+        {
+            if (!(pfds[i].revents & POLLIN))
+            {
+                continue;
+            }
+            if (::read(heavy[i], buf, sizeof buf) <= 0)
+            {
+                fprintf(stderr, "read error\n");
+                exit(1);
+            }
+            if (++done[i] < rounds)
+            {
+                ::write(heavy[i], "p", 1);
+            }
+            else
+            {
+                pfds[i].fd = -1;
+                ++finished;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    static const char *kPolicies[] = {"roundRobin", "leastConn", "p2cLag", "p2cQueue", "hashPeer"};
+    fprintf(stderr, "policy=%s heavy=%d threads=%d rounds=%d workUs=%d\n",
+            kPolicies[server->threadPool()->placementPolicy()], numHeavy, numThreads, rounds, g_workUs);
+    fprintf(stderr, "connections per loop:");
+    for (EventLoop *loop : server->threadPool()->getAllLoops())
+    {
+        fprintf(stderr, " %d", loop->numConnections());
+    }
+    fprintf(stderr, "\n%.3f s, %.0f round trips/s\n", seconds, numHeavy * rounds / seconds);
+
+    for (int fd : heavy)
+    {
+        ::close(fd);
+    }
+    serverLoop->runAfter(0.1, [serverLoop]() { serverLoop->quit(); });
+}
+
+int main(int argc, char *argv[])
+{
+    int numHeavy = argc > 1 ? atoi(argv[1]) : 16;
+    int numThreads = argc > 2 ? atoi(argv[2]) : 4;
+    int policy = argc > 3 ? atoi(argv[3]) : 0;
+    int rounds = argc > 4 ? atoi(argv[4]) : 2000;
+    g_workUs = argc > 5 ? atoi(argv[5]) : 20;
+    if (policy < 0 || policy > 4)
+    {
+        policy = 0;
+    }
+
+    EventLoop loop(Poller::kEpoll);
+    TcpServer server(&loop, InetAddress(kPort), "benchPlacement", TcpServer::KReusePost);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.setThreadNum(numThreads);
+    server.setPlacementPolicy(static_cast<EventLoopThreadPool::PlacementPolicy>(policy));
+    server.start();
+
+    std::thread client(runClient, &loop, &server, numHeavy, numThreads, rounds);
+    loop.loop();
+    client.join();
+    return 0;
+}
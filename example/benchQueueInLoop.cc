@@ -0,0 +1,152 @@
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/EventLoopThread.h>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * 跨线程投递任务的压测：多个生产者线程同时向同一个loop投递任务
+ * 模式0：EventLoop::queueInLoop（无锁MPSC队列 + 合并唤醒）
+ * 模式1：原来的实现，std::mutex保护的std::vector，loop一次swap取走，每次投递都写eventfd
+ * 模式2：两种都跑一遍，对比吞吐
+ * 用法：./benchQueueInLoop [生产者线程数] [每个线程的任务数] [模式]
+ */
+
+using Functor = std::function<void()>;
+
+// 原来queueInLoop/doPendingFunctors的做法，独立实现一个最小的loop线程作为对照
+class LegacyLoop
+{
+public:
+    LegacyLoop()
+        : wakeupFd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        , quit_(false)
+        , thread_(&LegacyLoop::loop, this)
+    {
+    }
+
+    ~LegacyLoop()
+    {
+        queueInLoop([this]() { quit_ = true; });
+        thread_.join();
+        ::close(wakeupFd_);
+    }
+
+    void queueInLoop(Functor cb)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pendingFunctors_.emplace_back(std::move(cb));
+        }
+        uint64_t one = 1;
+        ::write(wakeupFd_, &one, sizeof one);
+    }
+
+private:
+    void loop()
+    {
+        struct pollfd pfd = {wakeupFd_, POLLIN, 0};
+        while (!quit_)
+        {
+            ::poll(&pfd, 1, 10000);
+            uint64_t one;
+            ::read(wakeupFd_, &one, sizeof one);
+            std::vector<Functor> functors;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                functors.swap(pendingFunctors_);
+            }
+            for (const Functor &functor : functors)
+            {
+                functor();
+            }
+        }
+    }
+
+    int wakeupFd_;
+    bool quit_;     // 只在loop线程中访问
+    std::mutex mutex_;
+    std::vector<Functor> pendingFunctors_;
+    std::thread thread_;
+};
+
+// 多个生产者同时投递，最后一个任务执行完返回总耗时（秒）
+template <typename Queue>
+static double runProducers(Queue queue, int numProducers, int tasksPerProducer, int64_t *counter)
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool finished = false;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int i = 0; i < numProducers; ++i)
+    {
+        producers.emplace_back([&queue, counter, tasksPerProducer]() {
+            for (int j = 0; j < tasksPerProducer; ++j)
+            {
+                queue([counter]() { ++*counter; });
+            }
+        });
+    }
+    for (std::thread &t : producers)
+    {
+        t.join();
+    }
+
+    // 所有任务都已经入队，最后一个任务执行时说明前面的都执行完了
+    queue([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished = true;
+        cond.notify_one();
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!finished)
+        {
+            cond.wait(lock);
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int numProducers = argc > 1 ? atoi(argv[1]) : 4;
+    int tasksPerProducer = argc > 2 ? atoi(argv[2]) : 1000000;
+    int mode = argc > 3 ? atoi(argv[3]) : 2;
+    int64_t total = static_cast<int64_t>(numProducers) * tasksPerProducer;
+
+    if (mode == 0 || mode == 2)
+    {
+        EventLoopThread loopThread;
+        EventLoop *loop = loopThread.startLoop();
+        int64_t counter = 0;    // 只在loop线程中修改
+        double seconds = runProducers([loop](Functor cb) { loop->queueInLoop(std::move(cb)); },
+                                      numProducers, tasksPerProducer, &counter);
+        fprintf(stderr, "mpsc:         producers=%d tasks=%ld executed=%ld time=%.3fs throughput=%.2f Mtasks/s\n",
+            numProducers, total, counter, seconds, total / seconds / 1e6);
+        fprintf(stderr, "              eventfd wakeups issued=%lu suppressed=%lu\n",
+            loop->wakeupsIssued(), loop->wakeupsSuppressed());
+    }
+    if (mode == 1 || mode == 2)
+    {
+        LegacyLoop legacy;
+        int64_t counter = 0;
+        double seconds = runProducers([&legacy](Functor cb) { legacy.queueInLoop(std::move(cb)); },
+                                      numProducers, tasksPerProducer, &counter);
+        fprintf(stderr, "mutex+vector: producers=%d tasks=%ld executed=%ld time=%.3fs throughput=%.2f Mtasks/s\n",
+            numProducers, total, counter, seconds, total / seconds / 1e6);
+    }
+    return 0;
+}
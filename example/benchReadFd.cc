@@ -0,0 +1,119 @@
+#include <myMuduo/Buffer.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+/**
+ * Buffer::readFd的微基准，使用一对unix域套接字
+ * 1. 小消息：写一条消息，readFd读出来，取走，统计每次readFd的耗时
+ * 2. 大流量：另一个线程连续写，readFd读到阻塞为止，每次读完就取走，统计吞吐和平均每次读到的字节数
+ * 3. 大流量之后再收小消息，看缓冲区的容量能不能缩回来
+ * 用法：./benchReadFd [小消息字节数] [小消息次数] [大流量MB]
+ * 压测结果输出到stderr
+ */
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void smallMessages(int fds[2], Buffer *buf, size_t size, int count, const char *name)
+{
+    std::string msg(size, 'x');
+    int saveErrno = 0;
+    double readNs = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (::write(fds[1], msg.data(), msg.size()) != static_cast<ssize_t>(msg.size()))
+        {
+            fprintf(stderr, "write error: %s\n", strerror(errno));
+            exit(1);
+        }
+        auto start = std::chrono::steady_clock::now();
+        ssize_t n = buf->readFd(fds[0], &saveErrno);
+        readNs += secondsSince(start) * 1e9;
+        if (n != static_cast<ssize_t>(size))
+        {
+            fprintf(stderr, "short read %zd\n", n);
+            exit(1);
+        }
+        buf->retrieveAll();
+    }
+    fprintf(stderr, "%-28s %8.1f ns/readFd, capacity=%zu\n",
+            name, readNs / count, buf->internalCapacity());
+}
+
+static void bulkStream(int fds[2], Buffer *buf, size_t totalBytes)
+{
+    std::thread writer([fds, totalBytes]() {
+        std::string chunk(256 * 1024, 'y');
+        size_t sent = 0;
+        while (sent < totalBytes)
+        {
+            size_t len = std::min(chunk.size(), totalBytes - sent);
+            ssize_t n = ::write(fds[1], chunk.data(), len);
+            if (n <= 0)
+            {
+                fprintf(stderr, "write error: %s\n", strerror(errno));
+                exit(1);
+            }
+            sent += n;
+        }
+    });
+
+    int saveErrno = 0;
+    size_t received = 0;
+    int64_t reads = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (received < totalBytes)
+    {
+        ssize_t n = buf->readFd(fds[0], &saveErrno);
+        if (n <= 0)
+        {
+            fprintf(stderr, "read error: %s\n", strerror(saveErrno));
+            exit(1);
+        }
+        received += n;
+        ++reads;
+        buf->retrieveAll();
+    }
+    double seconds = secondsSince(start);
+    writer.join();
+    fprintf(stderr, "%-28s %8.0f MB/s, %lld reads, %.0f bytes/read, capacity=%zu\n",
+            "bulk stream", totalBytes / seconds / (1 << 20), (long long)reads,
+            static_cast<double>(totalBytes) / reads, buf->internalCapacity());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t smallSize = argc > 1 ? atoi(argv[1]) : 64;
+    int count = argc > 2 ? atoi(argv[2]) : 200000;
+    size_t bulkMB = argc > 3 ? atoi(argv[3]) : 1024;
+
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+    {
+        fprintf(stderr, "socketpair error: %s\n", strerror(errno));
+        return 1;
+    }
+    int sndbuf = 1 << 20;
+    ::setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+
+    Buffer buf;
+    smallMessages(fds, &buf, smallSize, count, "small messages");
+    bulkStream(fds, &buf, bulkMB << 20);
+    smallMessages(fds, &buf, smallSize, count, "small messages after bulk");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return 0;
+}
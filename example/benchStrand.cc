@@ -0,0 +1,206 @@
+#include <myMuduo/TcpServer.h>
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/ThreadPool.h>
+#include <myMuduo/Strand.h>
+#include <myMuduo/Logger.h>
+
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 按连接串行执行压测：客户端在每条连接上流水线发送编号的请求（每行8位编号），
+ * 服务端把每个请求交给工作线程处理（忙算0~2*workUs微秒，随编号变化），响应就是请求本身
+ * 模式0直接ThreadPool::submit，同一连接的请求会并行执行、响应乱序；模式1使用ConnectionExecutor
+ * 客户端检查响应顺序并统计乱序的个数
+ * 用法：./benchStrand [连接数] [每条连接的请求数] [workUs] [模式] [工作线程数]
+ * 压测结果输出到stderr，库日志输出到stdout，可以把stdout重定向到/dev/null
+ */
+
+static const uint16_t kPort = 9987;
+static const size_t kLineSize = 9;     // 8位编号加换行
+
+static int g_workUs = 20;
+static ThreadPool *g_pool = nullptr;
+static ConnectionExecutor *g_executor = nullptr;
+
+static std::string handle(const std::string &request)
+{
+    // 不同请求的耗时不同，没有串行约束时后面的请求可能先完成
+    int id = atoi(request.c_str());
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(g_workUs * (id % 3));
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+    return request;
+}
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+    }
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    while (buf->readableBytes() >= kLineSize)
+    {
+        std::string request(buf->peek(), kLineSize);
+        buf->retrieve(kLineSize);
+        if (g_executor)
+        {
+            g_executor->dispatch(conn, std::bind(handle, request));
+        }
+        else
+        {
+            g_pool->submit(conn->getLoop(), std::bind(handle, request),
+                [conn](const std::string &response) { conn->send(response); });
+        }
+    }
+}
+
+static void runClient(EventLoop *serverLoop, int numConns, int requests, int mode)
+{
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::vector<struct pollfd> pfds(numConns);
+    std::vector<int> expected(numConns, 0);
+    std::vector<std::string> pending(numConns);
+    for (int i = 0; i < numConns; ++i)
+    {
+        pfds[i].fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        pfds[i].events = POLLIN;
+        if (::connect(pfds[i].fd, (struct sockaddr*)&addr, sizeof addr) < 0)
+        {
+            fprintf(stderr, "connect error: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    // 一次把所有请求写出去
+    for (int i = 0; i < numConns; ++i)
+    {
+        std::string all;
+        char line[16];
+        for (int id = 0; id < requests; ++id)
+        {
+            snprintf(line, sizeof line, "%08d\n", id);
+            all += line;
+        }
+        size_t sent = 0;
+        while (sent < all.size())
+        {
+            ssize_t n = ::write(pfds[i].fd, all.data() + sent, all.size() - sent);
+            if (n <= 0)
+            {
+                fprintf(stderr, "write error: %s\n", strerror(errno));
+                exit(1);
+            }
+            sent += n;
+        }
+    }
+
+    int64_t outOfOrder = 0;
+    int finished = 0;
+    char buf[65536];
+    while (finished < numConns)
+    {
+        ::poll(pfds.data(), pfds.size(), -1);
+        for (int i = 0; i < numConns; ++i)
+        {
+            if (!(pfds[i].revents & POLLIN))
+            {
+                continue;
+            }
+            ssize_t n = ::read(pfds[i].fd, buf, sizeof buf);
+            if (n <= 0)
+            {
+                fprintf(stderr, "read error\n");
+                exit(1);
+            }
+            pending[i].append(buf, n);
+            size_t pos = 0;
+            while (pending[i].size() - pos >= kLineSize)
+            {
+                if (atoi(pending[i].c_str() + pos) != expected[i])
+                {
+                    ++outOfOrder;
+                }
+                ++expected[i];
+                pos += kLineSize;
+            }
+            pending[i].erase(0, pos);
+            if (expected[i] == requests)
+            {
+                pfds[i].fd = -pfds[i].fd - 1;   // poll会忽略负的fd
+                ++finished;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    int64_t total = static_cast<int64_t>(numConns) * requests;
+    fprintf(stderr, "mode=%s conns=%d requests=%d workUs=%d workers=%d\n",
+            mode ? "strand" : "unordered", numConns, requests, g_workUs, g_pool->numThreads());
+    fprintf(stderr, "%.3f s, %.0f requests/s, out of order=%lld, stolen=%llu\n",
+            seconds, total / seconds, (long long)outOfOrder, (unsigned long long)g_pool->tasksStolen());
+
+    for (struct pollfd &p : pfds)
+    {
+        ::close(-p.fd - 1);
+    }
+    serverLoop->runAfter(0.2, [serverLoop]() { serverLoop->quit(); });
+}
+
+int main(int argc, char *argv[])
+{
+    int numConns = argc > 1 ? atoi(argv[1]) : 8;
+    int requests = argc > 2 ? atoi(argv[2]) : 2000;
+    g_workUs = argc > 3 ? atoi(argv[3]) : 20;
+    int mode = argc > 4 ? atoi(argv[4]) : 1;
+    int numWorkers = argc > 5 ? atoi(argv[5]) : 4;
+
+    ThreadPool pool("worker");
+    pool.setThreadNum(numWorkers);
+    pool.start();
+    g_pool = &pool;
+    ConnectionExecutor executor(&pool);
+    if (mode == 1)
+    {
+        g_executor = &executor;
+    }
+
+    EventLoop loop(Poller::kEpoll);
+    TcpServer server(&loop, InetAddress(kPort), "benchStrand", TcpServer::KReusePost);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::thread client(runClient, &loop, numConns, requests, mode);
+    loop.loop();
+    client.join();
+    // 先停掉线程池，之后不会再有响应投递到loop
+    pool.stop();
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <myMuduo/TcpServer.h>
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/ThreadPool.h>
+#include <myMuduo/Logger.h>
+
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 计算任务卸载压测：一个IO loop，若干重连接每个请求需要忙算workUs微秒，另有一条探测连接做乒乓并记录往返时延
+ * 模式0在onMessage中直接计算，模式1交给ThreadPool计算，结果通过continuation回到loop中发送
+ * 用法：./benchThreadPool [重连接数] [探测次数] [workUs] [模式] [工作线程数]
+ * 压测结果输出到stderr，库日志输出到stdout，可以把stdout重定向到/dev/null
+ */
+
+static const uint16_t kPort = 9986;
+
+static int g_workUs = 200;
+static ThreadPool *g_pool = nullptr;
+
+static std::string compute(size_t n)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(g_workUs);
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+    return std::string(n, 'h');
+}
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+    }
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    std::string msg = buf->retrieveAllAsString();
+    size_t heavy = std::count(msg.begin(), msg.end(), 'h');
+    size_t probes = msg.size() - heavy;
+    if (probes > 0)
+    {
+        conn->send(std::string(probes, 'p'));
+    }
+    if (heavy == 0)
+    {
+        return;
+    }
+    if (g_pool == nullptr)
+    {
+        conn->send(compute(heavy));
+        return;
+    }
+    // 计算在工作线程中完成，发送在连接所属的loop中
+    g_pool->submit(conn->getLoop(),
+        std::bind(compute, heavy),
+        [conn](const std::string &result) { conn->send(result); });
+}
+
+static int connectOne()
+{
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof addr) < 0)
+    {
+        fprintf(stderr, "connect error: %s\n", strerror(errno));
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    return fd;
+}
+
+static void runClient(EventLoop *serverLoop, int numHeavy, int samples, int mode)
+{
+    using Clock = std::chrono::steady_clock;
+    std::vector<struct pollfd> pfds(numHeavy + 1);
+    for (int i = 0; i <= numHeavy; ++i)
+    {
+        pfds[i].fd = connectOne();
+        pfds[i].events = POLLIN;
+    }
+    int probe = numHeavy;
+    std::vector<double> rtts;
+    int64_t heavyDone = 0;
+    char buf[4096];
+
+    auto start = Clock::now();
+    for (int i = 0; i < numHeavy; ++i)
+    {
+        ::write(pfds[i].fd, "h", 1);
+    }
+    auto probeSent = Clock::now();
+    ::write(pfds[probe].fd, "p", 1);
+    while (static_cast<int>(rtts.size()) < samples)
+    {
+        ::poll(pfds.data(), pfds.size(), -1);
+        for (int i = 0; i <= numHeavy; ++i)
+        {
+            if (!(pfds[i].revents & POLLIN))
+            {
+                continue;
+            }
+            ssize_t n = ::read(pfds[i].fd, buf, sizeof buf);
+            if (n <= 0)
+            {
+                fprintf(stderr, "read error\n");
+                exit(1);
+            }
+            if (i == probe)
+            {
+                rtts.push_back(std::chrono::duration<double, std::micro>(Clock::now() - probeSent).count());
+                probeSent = Clock::now();
+                ::write(pfds[probe].fd, "p", 1);
+            }
+            else
+            {
+                heavyDone += n;
+                ::write(pfds[i].fd, "h", 1);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(rtts.begin(), rtts.end());
+    fprintf(stderr, "mode=%s heavy=%d workUs=%d workers=%d\n", mode ? "offload" : "inline",
+            numHeavy, g_workUs, g_pool ? g_pool->numThreads() : 0);
+    fprintf(stderr, "probe rtt us: p50=%.0f p99=%.0f max=%.0f\n",
+            rtts[rtts.size() / 2], rtts[rtts.size() * 99 / 100], rtts.back());
+    fprintf(stderr, "heavy requests: %.0f/s", heavyDone / seconds);
+    if (g_pool)
+    {
+        fprintf(stderr, ", tasks=%llu stolen=%llu",
+                (unsigned long long)g_pool->tasksRun(), (unsigned long long)g_pool->tasksStolen());
+    }
+    fprintf(stderr, "\n");
+
+    for (struct pollfd &p : pfds)
+    {
+        ::close(p.fd);
+    }
+    serverLoop->runAfter(0.2, [serverLoop]() { serverLoop->quit(); });
+}
+
+int main(int argc, char *argv[])
+{
+    int numHeavy = argc > 1 ? atoi(argv[1]) : 8;
+    int samples = argc > 2 ? atoi(argv[2]) : 2000;
+    g_workUs = argc > 3 ? atoi(argv[3]) : 200;
+    int mode = argc > 4 ? atoi(argv[4]) : 0;
+    int numWorkers = argc > 5 ? atoi(argv[5]) : 4;
+
+    ThreadPool pool("compute");
+    if (mode == 1)
+    {
+        pool.setThreadNum(numWorkers);
+        pool.start();
+        g_pool = &pool;
+    }
+
+    EventLoop loop(Poller::kEpoll);
+    TcpServer server(&loop, InetAddress(kPort), "benchThreadPool", TcpServer::KReusePost);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::thread client(runClient, &loop, numHeavy, samples, mode);
+    loop.loop();
+    client.join();
+    // 先停掉线程池，之后不会再有continuation投递到loop
+    pool.stop();
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <myMuduo/EventLoop.h>
+#include <myMuduo/EventLoopThread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/**
+ * 跨线程投递任务的正确性压测：多个生产者线程每轮投递几个任务，然后等自己投递的任务全部执行完再进入下一轮
+ * 等待期间这个生产者不再投递，如果loop被唤醒后漏掉了已经入队的任务，就会一直等不到，超时后报错退出
+ * 用法：./stressQueueInLoop [生产者线程数] [每个线程的轮数]
+ * 结果输出到stderr，全部任务都执行了返回0，否则返回1
+ */
+
+static const int kTimeoutMs = 2000;
+
+struct Producer
+{
+    Producer() : executed(0), pushed(0) {}
+
+    std::atomic<int64_t> executed;  // loop线程执行时加一
+    int64_t pushed;                 // 只在生产者线程中使用
+};
+
+int main(int argc, char *argv[])
+{
+    int numProducers = argc > 1 ? atoi(argv[1]) : 4;
+    int rounds = argc > 2 ? atoi(argv[2]) : 50000;
+
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+
+    std::vector<Producer> producers(numProducers);
+    std::atomic_bool stuck(false);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numProducers; ++i)
+    {
+        threads.emplace_back([loop, &producers, &stuck, i, rounds]() {
+            Producer &self = producers[i];
+            for (int r = 0; r < rounds && !stuck; ++r)
+            {
+                // 每轮1~3个任务，让队列经常在空和只有一个节点之间切换
+                int batch = 1 + (r + i) % 3;
+                for (int j = 0; j < batch; ++j)
+                {
+                    ++self.pushed;
+                    loop->queueInLoop([&self]() { self.executed.fetch_add(1, std::memory_order_release); });
+                }
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kTimeoutMs);
+                while (self.executed.load(std::memory_order_acquire) != self.pushed)
+                {
+                    if (std::chrono::steady_clock::now() > deadline)
+                    {
+                        fprintf(stderr, "producer %d round %d: %lld of %lld tasks executed after %d ms\n",
+                                i, r, (long long)self.executed.load(), (long long)self.pushed, kTimeoutMs);
+                        stuck = true;
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int64_t total = 0;
+    for (Producer &p : producers)
+    {
+        total += p.pushed;
+    }
+    fprintf(stderr, "producers=%d rounds=%d tasks=%lld time=%.3fs %s\n",
+            numProducers, rounds, (long long)total, seconds, stuck ? "FAILED" : "ok");
+    return stuck ? 1 : 0;
+}
@@ -3,28 +3,65 @@
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "InetAddress.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
 
 class EventLoop;
-class InetAddress;
 
 class Acceptor : noncopyable
 {
 public:
-    using NewConnectionCallback = std::function<void(int sockfd, const InetAddress&)>;
+    // accept到的一个连接
+    struct Accepted
+    {
+        int sockfd;
+        InetAddress peerAddr;
+    };
+    using AcceptedList = std::vector<Accepted>;
+    // 一次可读事件中accept到的所有连接一起回调，回调返回之后列表失效
+    using NewConnectionCallback = std::function<void(const AcceptedList&)>;
+
+    // 默认每次可读事件最多accept的连接数
+    static const int kDefaultAcceptBatch = 32;
+
     Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
     ~Acceptor();
 
     void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+    // 每次可读事件循环accept直到EAGAIN或者达到maxBatch，listen之前设置
+    void setAcceptBatch(int maxBatch) { acceptBatch_ = maxBatch > 0 ? maxBatch : 1; }
 
     bool listenning() const { return listenning_; }
+    // 开始监听并把acceptChannel_注册到loop上，必须在loop线程中调用
     void listen();
+    // 只调用listen系统调用，不涉及loop，可以在任意线程中调用（之后仍然需要在loop线程中调用listen）
+    // SO_REUSEPORT分片时用它控制socket加入reuseport组的顺序
+    void listenSocket();
+    // 共享监听：把同一个listenfd以EPOLLEXCLUSIVE再注册到ioLoop上，由ioLoop自己accept并调用cb
+    // 可以对多个ioLoop分别调用，所有loop共用一个accept队列；在start的线程中调用，注册在ioLoop线程完成
+    void listenShared(EventLoop *ioLoop, const NewConnectionCallback &cb);
+    // 在各自的ioLoop中注销共享监听并等待完成，之后不会再有ioLoop回调，需要在ioLoop退出之前调用
+    void stopShared();
+    int fd() const { return acceptSocket_.fd(); }
+    EventLoop* ownerLoop() const { return loop_; }
 
 private:
     void handleRead();
+    // 循环accept一批连接交给cb，没有cb时直接关闭
+    void acceptBatch(const NewConnectionCallback &cb);
+    // fd用完时用预留的idleFd_接收并立即关闭一个连接，否则水平触发的listenfd会一直可读
+    void dropOnEmfile();
 
     EventLoop *loop_;  // Acceptor用的就是用户定义的那个baseLoop，也称mainLoop
     Socket acceptSocket_;
     Channel acceptChannel_;
     NewConnectionCallback newConnectionCallback_;
     bool listenning_;
+    int acceptBatch_;
+    int idleFd_;                // 预留的空闲fd，EMFILE时让出来
+    std::mutex idleFdMutex_;    // 共享监听时多个loop可能同时遇到EMFILE
+    std::vector<std::unique_ptr<Channel>> sharedChannels_;    // 共享监听时每个ioLoop一个
 };
\ No newline at end of file
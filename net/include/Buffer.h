@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <utility>
 
 /// A buffer class modeled after org.jboss.netty.buffer.ChannelBuffer
 ///
@@ -24,15 +25,30 @@ class Buffer : noncopyable
 public:
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;
+    // readFd每次至少准备的可写空间的上下限
+    static const size_t kMinReadHint = 1024;
+    static const size_t kMaxReadHint = 256 * 1024;
 
     explicit Buffer(size_t initialSize = kInitialSize)
         : buffer_(kCheapPrepend + initialSize)
         , readerIndex_(kCheapPrepend)
         , writerIndex_(kCheapPrepend)
+        , readHint_(kMinReadHint)
+        , smallReads_(0)
     {}
 
     ~Buffer();
 
+    // 交换两个缓冲区的内容，只交换指针，不拷贝数据
+    void swap(Buffer &rhs)
+    {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+        std::swap(readHint_, rhs.readHint_);
+        std::swap(smallReads_, rhs.smallReads_);
+    }
+
     size_t readableBytes() const
     {
         return writerIndex_ - readerIndex_;
@@ -48,6 +64,11 @@ public:
         return readerIndex_;
     }
 
+    size_t internalCapacity() const
+    {
+        return buffer_.capacity();
+    }
+
     // 返回可读数据缓冲区的起始地址
     const char* peek() const 
     {
@@ -110,6 +131,22 @@ public:
         writerIndex_ += len;
     }
 
+    // 释放多余的空间，只保留可读数据加上reserve字节的可写空间
+    void shrink(size_t reserve)
+    {
+        Buffer other(readableBytes() + reserve);
+        other.append(peek(), readableBytes());
+        other.readHint_ = readHint_;
+        other.smallReads_ = smallReads_;
+        swap(other);
+    }
+
+    // readFd预计下一次能读到的字节数，根据最近几次读到的字节数调整
+    size_t readHint() const
+    {
+        return readHint_;
+    }
+
     ssize_t readFd(int fd, int* saveErrno);
 
     ssize_t writeFd(int fd, int* saveErrno);
@@ -145,7 +182,12 @@ private:
         }
     }
 
+    // 根据这次读到的字节数调整readHint_
+    void adjustReadHint(size_t n);
+
     std::vector<char> buffer_;
     size_t readerIndex_;
     size_t writerIndex_;
+    size_t readHint_;
+    int smallReads_;        // 连续读到不足readHint_一半的次数
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <stddef.h>
+#include <sys/types.h>
+
+struct iovec;
+
+/**
+ * 分段的发送缓冲区，由一串分段组成，每个分段是一块池化的固定大小内存块中的一段，或者引用外部的一段内存
+ * 追加只写在最后一块的空闲部分或者新的块里，取走只移动第一个分段的起点，已有的数据不会被搬动，
+ * 大响应不会触发整块的扩容拷贝；外部分片（比如共享的std::string）直接挂进来，不拷贝数据
+ * writeFd用writev一次写出最多IOV_MAX个分段
+ *
+ *  segments_:  [block 已写部分] -> [外部分片] -> [block 已写部分|空闲]
+ *               ^ 取走从这里开始                                 ^ 追加从这里开始
+ *
+ * 内存块按线程缓存，只能在一个线程中使用（TcpConnection的发送缓冲区都在所属loop线程中操作）
+ */
+class ChainBuffer : noncopyable
+{
+public:
+    static const size_t kBlockSize = 16 * 1024;
+
+    ChainBuffer();
+    ~ChainBuffer();
+
+    // 交换两个缓冲区的内容，不拷贝数据
+    void swap(ChainBuffer &rhs);
+
+    size_t readableBytes() const { return readable_; }
+    size_t numSegments() const { return segments_.size(); }
+
+    // 拷贝到内存块中，小块数据会合并到最后一块的空闲部分
+    void append(const char *data, size_t len);
+    void append(const std::string &str) { append(str.data(), str.size()); }
+
+    // 不拷贝，引用外部的[data, data + len)，owner保证这段内存在数据写出去之前有效
+    void appendExternal(const char *data, size_t len, std::shared_ptr<const void> owner);
+    // 引用一个共享的字符串，从offset开始，offset超过字符串长度时记录错误，不追加
+    void appendExternal(const std::shared_ptr<const std::string> &str, size_t offset = 0);
+
+    void retrieve(size_t len);
+    void retrieveAll();
+
+    // 从头开始最多填maxIov个分段，返回填了几个
+    int fillIovec(struct iovec *iov, int maxIov) const;
+
+    // writev一次，写出去的数据需要调用者retrieve
+    ssize_t writeFd(int fd, int *saveErrno);
+
+    // 池化的内存块，定义在ChainBuffer.cc中
+    struct Block;
+
+private:
+    struct Segment
+    {
+        const char *data;       // 可读数据的起点
+        size_t len;
+        Block *block;           // 所在的内存块，外部分片为nullptr
+        std::shared_ptr<const void> owner;     // 外部分片的持有者
+    };
+
+    // 最后一个分段是内存块时，返回块中剩下的空闲字节数，否则返回0
+    size_t tailWritable() const;
+
+    static Block* allocBlock();
+    static void freeBlock(Block *block);
+
+    std::deque<Segment> segments_;
+    size_t readable_;
+};
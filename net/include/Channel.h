@@ -50,16 +50,25 @@ public:
     void enableReading() { events_ |= kReadEvent; update(); }
     void disableReading() { events_ &= ~kReadEvent; update(); }
     void enableWriting() { events_ |= kWriteEvent; update(); }
-    void disableWriting() { events_ |= ~kWriteEvent; update(); }
+    void disableWriting() { events_ &= ~kWriteEvent; update(); }
     void disableAll() { events_ = kNoneEvent; update(); }
 
     // 返回fd当前的事件状态
     bool isNoneEvent() const { return events_ == kNoneEvent; }
-    bool isWriting() const { return events_ == kWriteEvent; }
-    bool isReading() const { return events_ == kReadEvent; }
-
-    int index() { return index_; }
-    void set_index(int idx) { index_ = idx; }; 
+    bool isWriting() const { return events_ & kWriteEvent; }
+    bool isReading() const { return events_ & kReadEvent; }
+
+    // 边沿触发模式，需要在第一次enable之前设置
+    // epoll中一次性注册EPOLLIN|EPOLLOUT|EPOLLET，之后enable/disableWriting只修改events_，
+    // 不再需要epoll_ctl MOD；读写回调需要一直读写到EAGAIN
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool edgeTriggered() const { return edgeTriggered_; }
+    // EPOLLEXCLUSIVE，同一个fd注册在多个epoll中时一个事件只唤醒其中一部分，需要在第一次enable之前设置
+    // 内核不允许对它做epoll_ctl MOD，注册之后只能enable一次再disableAll
+    void setExclusive(bool on) { exclusive_ = on; }
+    bool exclusive() const { return exclusive_; }
+    // 实际注册到epoll中的事件
+    int pollEvents() const;
 
     // one loop per thread
     // 当前的channel属于哪一个eventLoop（一个循环监听着多个channel）
@@ -75,12 +84,15 @@ private:
     static const int kNoneEvent;
     static const int kReadEvent;
     static const int kWriteEvent;
+    static const int kEdgeEvent;
+    static const int kExclusiveEvent;
 
     EventLoop *loop_;   // 事件循环
     const int fd_;      // poller监听的对象
     int events_;        // 注册fd感兴趣的事件
     int revents_;       // poller返回具体发生的事件
-    int index_;       
+    bool edgeTriggered_;
+    bool exclusive_;
     
     // 实现对象销毁后，自动跳过无效回调
     std::weak_ptr<void> tie_;  // 用于监听多线程中的状态
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+class Channel;
+
+/**
+ * Poller中按fd索引的channel表，fd是小而密集的整数，直接用fd做下标，不需要哈希
+ * 分页存储：每页kPageSize个表项，用到时才分配，扩容时不搬动已有的表项，稀疏的大fd也只多占几页
+ * 表项同时记录channel在poller中的状态（kNew/kAdded/kDeleted）
+ */
+class ChannelTable
+{
+public:
+    enum State
+    {
+        kNew = -1,      // 没有添加到poller
+        kAdded = 1,     // 已经添加到poller
+        kDeleted = 2,   // 还在表中，但已经从内核中删除（disableAll之后）
+    };
+
+    struct Entry
+    {
+        Entry() : channel(nullptr), state(kNew), kernelEvents(0), registered(false), dirty(false) {}
+
+        Channel *channel;
+        int state;
+        // 下面的字段由延迟提交修改的poller使用（EPollPoller）
+        uint32_t kernelEvents;  // 已经提交给内核的事件
+        bool registered;        // 是否已经注册到内核中
+        bool dirty;             // 是否已经在待提交的列表中
+    };
+
+    ChannelTable() : size_(0) {}
+
+    // fd所在的页还没有分配时返回nullptr
+    Entry* find(int fd)
+    {
+        size_t page = static_cast<size_t>(fd) >> kPageShift;
+        if (page >= pages_.size() || !pages_[page])
+        {
+            return nullptr;
+        }
+        return &pages_[page][fd & kPageMask];
+    }
+    const Entry* find(int fd) const
+    {
+        return const_cast<ChannelTable*>(this)->find(fd);
+    }
+
+    // fd所在的页不存在时分配
+    Entry& at(int fd)
+    {
+        size_t page = static_cast<size_t>(fd) >> kPageShift;
+        if (page >= pages_.size())
+        {
+            pages_.resize(page + 1);
+        }
+        if (!pages_[page])
+        {
+            pages_[page].reset(new Entry[kPageSize]);
+        }
+        return pages_[page][fd & kPageMask];
+    }
+
+    // 把channel放进表中，状态保持kNew，由poller修改
+    Entry& add(int fd, Channel *channel)
+    {
+        Entry &entry = at(fd);
+        if (entry.channel == nullptr)
+        {
+            ++size_;
+        }
+        entry.channel = channel;
+        return entry;
+    }
+
+    void remove(int fd)
+    {
+        Entry *entry = find(fd);
+        if (entry != nullptr && entry->channel != nullptr)
+        {
+            --size_;
+            *entry = Entry();
+        }
+    }
+
+    // 表中channel的个数
+    size_t size() const { return size_; }
+
+private:
+    static const int kPageShift = 10;
+    static const int kPageSize = 1 << kPageShift;
+    static const int kPageMask = kPageSize - 1;
+
+    std::vector<std::unique_ptr<Entry[]>> pages_;
+    size_t size_;
+};
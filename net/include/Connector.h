@@ -3,6 +3,7 @@
 #include "noncopyable.h"
 #include "InetAddress.h"
 #include "Callbacks.h"
+#include "TimerId.h"
 
 #include <memory>
 #include <functional>
@@ -65,4 +66,5 @@ private:
     std::unique_ptr<Channel> channel_;  // 客户端fd封装的channel
     NewConnectionCallback newConnectCallback_;
     int retryDelayMs_;                  // 重试间隔
+    TimerId timerId_;                   // 重连定时器
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <sys/epoll.h>
 
@@ -13,6 +14,10 @@ class Channel;
  * epoll_create 创建epollfd专属epoll的文件描述符
  * epoll_ctl    更新事件add/mod/del
  * epoll_wait   开启事件循环
+ *
+ * updateChannel只记录修改，一轮循环中的所有修改在下一次epoll_wait之前统一提交，
+ * 每个fd只提交最终的结果，开启又关闭写事件这样相互抵消的修改不会产生epoll_ctl
+ * removeChannel之后fd马上会被关闭，所以删除是立即提交的
  */
 
 class EPollPoller : public Poller
@@ -28,6 +33,12 @@ public:
     void updateChannel(Channel *channel) override;
     void removeChannel(Channel *channel) override;
 
+    uint64_t updatesSaved() const override
+    {
+        return updatesRequested_.load(std::memory_order_relaxed)
+            - updatesIssued_.load(std::memory_order_relaxed);
+    }
+
 private:
     // 事件集合的长度（源码默认为16）
     static const int kInitEventListSize = 16;
@@ -36,9 +47,16 @@ private:
     void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
     // 更新channel
     void update(int operation, Channel *channel);
+    // 把dirtyFds_中的修改提交给内核
+    void flushUpdates();
 
     using EventList = std::vector<epoll_event>;
 
     int epollfd_;
     EventList events_;
+    std::vector<int> dirtyFds_;     // 本轮修改过的fd，可能有重复，以表项的dirty为准
+
+    // 立即提交时会产生的epoll_ctl次数和实际的次数，只在loop线程中修改
+    std::atomic<uint64_t> updatesRequested_;
+    std::atomic<uint64_t> updatesIssued_;
 };
\ No newline at end of file
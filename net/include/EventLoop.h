@@ -4,20 +4,31 @@
 #include <vector>
 #include <atomic>
 #include <memory>
-#include <mutex>
 
 #include "noncopyable.h"
 #include "Channel.h"
 #include "Timestamp.h"
 #include "Poller.h"
 #include "CurrentThread.h"
+#include "MpscQueue.h"
+#include "InplaceFunction.h"
+#include "EventLoopStats.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+
+class TimerQueue;
+class TimingWheel;
+class IoUringPoller;
 
 class EventLoop : noncopyable
 {
 public:
-    using Functor = std::function<void()>;
+    // 投递给loop的任务，只能移动，捕获不超过kFunctorInlineSize字节时不会在堆上分配
+    static const size_t kFunctorInlineSize = 64;
+    using Functor = InplaceFunction<void(), kFunctorInlineSize>;
 
-    EventLoop();
+    // backend指定IO复用的实现，默认按照环境变量选择（见Poller::newDefaultPoller）
+    explicit EventLoop(Poller::Backend backend = Poller::kDefault);
     ~EventLoop();
 
     // 开启事件循环
@@ -26,15 +37,77 @@ public:
     void quit();
 
     Timestamp pollReturnTime() const { return pollReturnTime_; }
+    // 缓存的当前时间，每轮poll返回时刷新一次，loop线程中的回调读取它不需要再取时钟
+    // 精度是一轮循环，需要精确时间的地方（定时器）仍然使用Timestamp::now()
+    Timestamp now() const { return pollReturnTime_; }
 
     // 在当前loop中执行
     void runInLoop(Functor cb);
     // 把cb放入队列中，唤醒loop所在线程，执行cb
     void queueInLoop(Functor cb);
+    // 在loop线程中执行cb并等待它执行完，不能在其他loop等待本loop的同时被本loop反过来等待
+    void runInLoopAndWait(Functor cb);
+
+    // 定时器，线程安全，可以在其他线程中调用
+    // 在time时刻执行cb
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // 在delay秒之后执行cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器
+    void cancel(TimerId timerId);
+
+    // 忙轮询模式：每轮先以0超时调用poll自旋最多spinBudgetUs微秒，没有事件再阻塞等待
+    // 自旋连续落空时预算会自动减半，命中后再恢复，0表示关闭，可以在任意线程中设置
+    void setBusyPollUs(int spinBudgetUs) { busyPollUs_.store(spinBudgetUs, std::memory_order_relaxed); }
+    int busyPollUs() const { return busyPollUs_.load(std::memory_order_relaxed); }
+
+    // 忙轮询统计：自旋poll的次数、自旋中拿到事件的次数、预算用完转为阻塞poll的次数
+    uint64_t busyPollSpins() const { return busyPollSpins_.load(std::memory_order_relaxed); }
+    uint64_t busyPollHits() const { return busyPollHits_.load(std::memory_order_relaxed); }
+    uint64_t busyPollSleeps() const { return busyPollSleeps_.load(std::memory_order_relaxed); }
+
+    // 每轮循环的分阶段耗时统计，默认开启，可以在任意线程中开关
+    void setProfiling(bool on) { profiling_.store(on, std::memory_order_relaxed); }
+    // 任意线程读取统计快照，resetMaxCallback为true时同时把最长回调耗时清零
+    EventLoopStats stats(bool resetMaxCallback = false);
+
+    // 负载统计，EventLoopThreadPool的负载均衡策略读取，任意线程都可以读取
+    // 属于本loop的连接数，TcpConnection构造时加一、析构时减一
+    void adjustConnections(int delta) { numConnections_.fetch_add(delta, std::memory_order_relaxed); }
+    int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+    // 最近一轮doPendingFunctors执行的回调个数，反映的是最近的投递速率，不是当前的队列深度：
+    // loop阻塞在poll中时队列里积压的回调不会计入，投递方不维护原子计数
+    int64_t recentFunctorCount() const
+    {
+        return static_cast<int64_t>(recentFunctors_.load(std::memory_order_relaxed));
+    }
+    // 循环延迟（纳秒）：每轮处理事件和回调耗时的滑动平均，与当前这一轮已经忙了多久取较大值
+    // 依赖分阶段统计（setProfiling），关闭时为0
+    uint64_t loopLagNs() const;
+
+    // loop线程绑定的NUMA节点，-1表示没有绑定，由EventLoopThread设置
+    void setNumaNode(int node) { numaNode_ = node; }
+    int numaNode() const { return numaNode_; }
+
+    // poller合并事件修改后省掉的epoll_ctl次数，任意线程读取
+    uint64_t pollerUpdatesSaved() const { return poller_->updatesSaved(); }
+
+    // 使用io_uring后端时返回对应的Poller（TcpConnection的完成模式需要），否则返回nullptr
+    IoUringPoller* ioUringPoller() const { return ioUringPoller_; }
+
+    // 本loop的空闲超时时间轮，第一次使用时创建，只能在loop线程中调用
+    TimingWheel* timingWheel();
 
     // 用于唤醒loop所在线程，main reactor唤醒sub reactor执行操作
+    // 已经唤醒但还没有处理时不会重复写eventfd
     void wakeup();
 
+    // 实际写eventfd的次数和被合并掉的次数，可以在任意线程中读取
+    uint64_t wakeupsIssued() const { return wakeupsIssued_.load(std::memory_order_relaxed); }
+    uint64_t wakeupsSuppressed() const { return wakeupsSuppressed_.load(std::memory_order_relaxed); }
+
     // EventLoop调用Poller的方法
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
@@ -44,27 +117,71 @@ public:
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
 
 private:
-    void handleRead();          // wake uo
-    void doPendingFunctors();   // 回调
-
-
     using ChannelList = std::vector<Channel*>;
 
-    std::atomic_bool looping_;  // 原子操作，通过CAS实现
-    std::atomic_bool quit_;     // 标识退出loop循环
-    std::atomic_bool callingPendingFunctors_;  // 标识当前loop是否有需要执行的回调
+    void handleRead();          // wake uo
+    // 忙轮询模式下的poll
+    Timestamp busyPoll(ChannelList *activeChannels);
+    size_t doPendingFunctors(bool profiling);   // 回调，返回执行的个数
+
+    struct PendingFunctor;
+    struct FunctorNodeCache;
+    // 从本线程缓存的空闲节点中取一个，没有的话回收本loop归还的节点，都没有才new
+    PendingFunctor* allocFunctorNode();
+    // loop线程执行完回调后把节点归还到freeFunctors_
+    void freeFunctorNode(PendingFunctor *node);
+
+
+    // pendingFunctors_队列的侵入式节点
+    struct PendingFunctor
+    {
+        std::atomic<PendingFunctor*> next;
+        Functor functor;
+    };
+
+    // 下面几个原子变量会被其他线程读写，各自独占一个缓存行，避免伪共享
+    alignas(kCacheLineSize) std::atomic_bool looping_;  // 原子操作，通过CAS实现
+    alignas(kCacheLineSize) std::atomic_bool quit_;     // 标识退出loop循环
+    alignas(kCacheLineSize) std::atomic_bool callingPendingFunctors_;  // 标识当前loop是否有需要执行的回调
     // one loop pre thread 
     const pid_t threadId_;      // 当前loop所在线程id
     // 返回revent
     Timestamp pollReturnTime_;  // poller返回发生事件的channels的时间
     std::unique_ptr<Poller> poller_;
+    IoUringPoller *ioUringPoller_;              // poller_是io_uring时指向它
+    int numaNode_;
+    std::unique_ptr<TimerQueue> timerQueue_;    // 定时器队列，timerfd也注册在poller_上
+    std::unique_ptr<TimingWheel> timingWheel_;  // 连接空闲超时使用的时间轮，由timerQueue_驱动
 
     // 主要作用，当mainLoop获取一个新用户的channel，通过轮询算法选择一个subloop，将其唤醒处理channel
     int wakeupFd_;   // 使用的是eventfd()这个系统调用，是线程间的通信效率较高
     std::unique_ptr<Channel> wakeupChannel_;    // channel和fd进行绑定
+    // 已经写过eventfd但loop还没有开始处理回调，此时其他线程不需要再写
+    alignas(kCacheLineSize) std::atomic_bool wakeupPending_;
+    std::atomic<uint64_t> wakeupsIssued_;       // 只有真正写eventfd的线程修改
+    // 被合并掉的wakeup调用次数，单独一个缓存行，不和wakeupPending_争用
+    alignas(kCacheLineSize) std::atomic<uint64_t> wakeupsSuppressed_;
 
     ChannelList activeChannels_;
 
-    std::vector<Functor> pendingFunctors_;      // 存储loop需要执行的所有回调操作
-    std::mutex mutex_;      // 用于保护上面vector容器的线程安全
+    std::atomic_int busyPollUs_;        // 配置的自旋预算，0表示不自旋
+    int busyPollBudgetUs_;              // 当前实际使用的自旋预算，只在loop线程中使用
+    std::atomic<uint64_t> busyPollSpins_;
+    std::atomic<uint64_t> busyPollHits_;
+    std::atomic<uint64_t> busyPollSleeps_;
+
+    std::atomic_bool profiling_;
+    EventLoopProfiler profiler_;
+
+    // 负载统计
+    alignas(kCacheLineSize) std::atomic_int numConnections_;
+    alignas(kCacheLineSize) std::atomic<uint64_t> recentFunctors_;  // 下面三个只由loop线程写
+    std::atomic<uint64_t> lagEwmaNs_;
+    std::atomic<uint64_t> busySinceNs_;     // 本轮poll返回的时刻，阻塞在poll中时为0
+
+    // 存储loop需要执行的所有回调操作，无锁队列，其他线程投递任务不需要加锁
+    MpscQueue<PendingFunctor> pendingFunctors_;
+    // 执行完的节点由loop线程放回这里，生产者线程整体取走放入自己的线程缓存中复用
+    // 生产者只用exchange一次取走全部，不会出现ABA问题
+    alignas(kCacheLineSize) std::atomic<PendingFunctor*> freeFunctors_;
 }; 
\ No newline at end of file
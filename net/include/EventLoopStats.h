@@ -0,0 +1,98 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * EventLoop每轮循环的统计
+ * 只由loop线程写入（relaxed原子操作，没有锁也没有读-改-写指令），任意线程都可以读取快照
+ */
+
+// 按2的幂分桶的直方图快照，第i个桶统计 [2^(i-1), 2^i) 范围内的值，第0个桶统计0
+struct HistogramSnapshot
+{
+    static const int kBuckets = 48;
+
+    uint64_t buckets[kBuckets];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+    // 近似分位数，返回所在桶的上界，p取值0~1
+    uint64_t percentile(double p) const;
+};
+
+// 单写者直方图
+class LoopHistogram : noncopyable
+{
+public:
+    LoopHistogram();
+
+    // 只能在loop线程中调用
+    void add(uint64_t value);
+    // 任意线程
+    void snapshot(HistogramSnapshot *out) const;
+
+private:
+    static void bump(std::atomic<uint64_t> &counter, uint64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets_[HistogramSnapshot::kBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+// EventLoop::stats()返回的快照，时间的单位都是纳秒
+struct EventLoopStats
+{
+    uint64_t iterations;            // 循环的轮数
+    uint64_t pollNs;                // 阻塞在poller_->poll中的总时间
+    uint64_t handlerNs;             // 执行Channel::handleEvent的总时间
+    uint64_t functorNs;             // 执行doPendingFunctors的总时间
+    uint64_t maxCallbackNs;         // 单个回调（channel事件或者pending functor）的最长耗时
+
+    HistogramSnapshot loopLagNs;            // 每轮从poll返回到下一次poll之间的时间，即新事件最多需要等待的时间
+    HistogramSnapshot eventsPerIteration;   // 每轮的活跃channel数
+    HistogramSnapshot functorsPerIteration; // 每轮执行的pending functor数
+};
+
+// loop线程中记录统计的对象
+class EventLoopProfiler : noncopyable
+{
+public:
+    EventLoopProfiler();
+
+    // 单调时钟，纳秒
+    static uint64_t nowNs();
+
+    // 下面的方法只能在loop线程中调用
+    void recordIteration(uint64_t pollNs, uint64_t handlerNs, uint64_t functorNs,
+                         size_t numEvents, size_t numFunctors);
+    void recordCallback(uint64_t ns)
+    {
+        if (ns > maxCallbackNs_.load(std::memory_order_relaxed))
+        {
+            maxCallbackNs_.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    // 任意线程，resetMaxCallback为true时读取后把最长回调耗时清零，便于按时间窗口告警
+    void snapshot(EventLoopStats *out, bool resetMaxCallback);
+
+private:
+    std::atomic<uint64_t> iterations_;
+    std::atomic<uint64_t> pollNs_;
+    std::atomic<uint64_t> handlerNs_;
+    std::atomic<uint64_t> functorNs_;
+    std::atomic<uint64_t> maxCallbackNs_;
+    LoopHistogram loopLagNs_;
+    LoopHistogram eventsPerIteration_;
+    LoopHistogram functorsPerIteration_;
+};
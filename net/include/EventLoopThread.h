@@ -4,6 +4,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <string>
+#include <vector>
 
 #include "noncopyable.h"
 #include "Thread.h"
@@ -20,9 +21,18 @@ public:
         const std::string &name = std::string());
     ~EventLoopThread();
 
+    // startLoop之前调用，线程启动后、EventLoop构造之前绑定到cpus上
+    // numaNode >= 0时该线程的内存优先从这个节点分配，连接的缓冲区也会在loop线程中重新分配
+    void setPlacement(const std::vector<int> &cpus, int numaNode = -1)
+    {
+        cpus_ = cpus;
+        numaNode_ = numaNode;
+    }
+
     EventLoop* startLoop();
 private:
     void threadFunc();
+    void applyPlacement();
 
     EventLoop *loop_;
     bool exiting_;
@@ -30,4 +40,6 @@ private:
     std::mutex mutex_;
     std::condition_variable cond_;
     ThreadInitCallback callback_;
+    std::vector<int> cpus_;
+    int numaNode_;
 };
\ No newline at end of file
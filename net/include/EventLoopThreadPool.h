@@ -8,11 +8,22 @@
 
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool : noncopyable
 {
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
+
+    // 新连接分配给哪个subLoop，读取的是EventLoop自己维护的负载统计
+    enum PlacementPolicy
+    {
+        kRoundRobin,            // 轮询
+        kLeastConnections,      // 连接数最少的loop
+        kPowerOfTwoLag,         // 随机挑两个loop，取循环延迟（loopLagNs）小的
+        kPowerOfTwoQueue,       // 随机挑两个loop，取最近一轮执行回调（recentFunctorCount）少的
+        kHashPeer,              // 按对端IP哈希，同一个客户端总是落在同一个loop
+    };
     
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
     ~EventLoopThreadPool();
@@ -22,8 +33,31 @@ public:
 
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
-    // 如果工作在多线程中，baseLoop_默认以轮询的方式分配channel给subloop
+    // subLoop线程的CPU绑定方式
+    enum CpuPlacement
+    {
+        kNoPinning,         // 不绑定（默认）
+        kCpuList,           // 第i个loop绑定到cpus[i % cpus.size()]
+        kPhysicalCores,     // 每个物理核一个loop，不使用超线程的兄弟CPU
+        kNumaLocal,         // loop轮流分到各个NUMA节点，绑定到节点的所有CPU，内存从该节点分配
+    };
+
+    // start之前调用，cpus只在kCpuList时使用
+    // 线程在EventLoop构造之前完成绑定，除kNoPinning外loop线程的内存都优先从所在节点分配
+    void setCpuPlacement(CpuPlacement placement, const std::vector<int> &cpus = std::vector<int>())
+    {
+        cpuPlacement_ = placement;
+        cpuList_ = cpus;
+    }
+
+    // 分配策略，start之前或者在baseLoop线程中设置
+    void setPlacementPolicy(PlacementPolicy policy) { policy_ = policy; }
+    PlacementPolicy placementPolicy() const { return policy_; }
+
+    // 如果工作在多线程中，baseLoop_按照分配策略选择subloop，默认轮询
+    // 不知道对端地址时kHashPeer退化为轮询
     EventLoop* getNextLoop();
+    EventLoop* getNextLoop(const InetAddress &peerAddr);
 
     std::vector<EventLoop*> getAllLoops();
 
@@ -31,6 +65,13 @@ public:
     const std::string name() const { return name_; }
 
 private:
+    EventLoop* roundRobin();
+    // 随机挑两个不同的loop，load返回较小的那个
+    template <typename Load>
+    EventLoop* powerOfTwo(Load load);
+    uint32_t nextRandom();
+    // 计算第i个loop线程绑定的CPU和NUMA节点
+    void placementFor(int index, std::vector<int> *cpus, int *numaNode) const;
 
     // 这就是负责新用户的链接的线程
     EventLoop *baseLoop_;   // EventLoop loop
@@ -38,6 +79,10 @@ private:
     bool started_;
     int numThreads_;
     int next_;  // 轮询的下标
+    PlacementPolicy policy_;
+    CpuPlacement cpuPlacement_;
+    std::vector<int> cpuList_;
+    uint32_t randomState_;  // power of two choices用的xorshift随机数，只在baseLoop线程中使用
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;
 };
\ No newline at end of file
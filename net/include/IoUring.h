@@ -0,0 +1,75 @@
+#pragma once
+
+#ifdef MUDUO_HAVE_IO_URING
+
+#include "noncopyable.h"
+
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * io_uring的最小封装，直接使用io_uring_setup/io_uring_enter系统调用和mmap，不依赖liburing
+ * 只能在一个线程（所属EventLoop的线程）中使用
+ * 
+ * getSqe拿到的提交项只是写在共享内存中，直到submitAndWait时才一次性提交给内核，
+ * 所以一轮循环中的多次注册、修改只有一次系统调用
+ */
+class IoUring : noncopyable
+{
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    // 创建失败（内核不支持或者被禁用）时为false
+    bool valid() const { return ringFd_ >= 0; }
+    int fd() const { return ringFd_; }
+
+    // 获取一个空闲的提交项，提交队列满时会先把已有的提交给内核
+    io_uring_sqe* getSqe();
+
+    // 提交所有的提交项，并等待至少一个完成项或者超时
+    // timeoutMs < 0 一直等待，timeoutMs == 0 只提交不等待
+    int submitAndWait(int timeoutMs);
+
+    // 取出下一个完成项，没有返回nullptr，处理完需要调用cqeSeen
+    io_uring_cqe* peekCqe();
+    void cqeSeen();
+
+    // io_uring_register系统调用
+    int registerOp(unsigned opcode, void *arg, unsigned nrArgs);
+
+    // 累计的io_uring_enter调用次数
+    uint64_t numEnters() const { return numEnters_; }
+
+private:
+    int enter(unsigned toSubmit, unsigned minComplete, int timeoutMs);
+
+    int ringFd_;
+    io_uring_params params_;
+
+    void *sqRing_;
+    size_t sqRingSize_;
+    void *cqRing_;
+    size_t cqRingSize_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    // 提交队列
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned *sqArray_;
+    unsigned sqLocalTail_;      // 已经填写但还没有提交的位置
+    unsigned sqSubmitted_;      // 已经提交给内核的位置
+
+    // 完成队列
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe *cqes_;
+
+    uint64_t numEnters_;
+};
+
+#endif // MUDUO_HAVE_IO_URING
@@ -0,0 +1,159 @@
+#pragma once
+
+#ifdef MUDUO_HAVE_IO_URING
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "Poller.h"
+#include "Timestamp.h"
+#include "IoUring.h"
+#include "Buffer.h"
+#include "ChainBuffer.h"
+
+class Channel;
+
+/**
+ * 基于io_uring的Poller，实现和EPollPoller相同的就绪通知语义（水平触发）
+ * 
+ * 每个channel对应一个IORING_OP_POLL_ADD请求，注册、修改、删除都只是往提交队列里写一项，
+ * 在下一次poll时和等待一起通过一次io_uring_enter提交，
+ * 不再像epoll那样每次enableWriting/disableWriting都要一次epoll_ctl
+ * 
+ * 内核中multishot poll是边沿触发的（POLL_ADD也不接受IORING_POLL_ADD_LEVEL），
+ * 为了保持水平触发的语义，这里使用单次poll：注册时内核会先检查一次就绪状态，
+ * 完成后在下一次提交时重新注册，重新注册同样不需要额外的系统调用
+ * 
+ * user_data = (generation << 32) | (op << 24) | fd，每次重新注册generation加一，
+ * 已经被替换或者删除的请求返回的完成项因为generation不匹配被直接丢弃
+ * 
+ * 完成模式（TcpConnection::setCompletionMode）：
+ * 读使用multishot recv，数据由内核直接写入provided buffer ring中的缓冲区，
+ * 写把整个输出缓冲区交给一个send请求，一轮循环中的多次send合并成一次提交。
+ * 结果仍然通过channel的读写事件（POLLIN/POLLOUT）通知，由TcpConnection取走，
+ * 所以收发数据不再需要read/write系统调用，所有请求都随poll的io_uring_enter一起提交
+ */
+class IoUringPoller : public Poller
+{
+public:
+    explicit IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    // io_uring是否创建成功，失败时Poller::newDefaultPoller会退回到epoll
+    bool valid() const { return ring_.valid(); }
+
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+    // 以下是完成模式的接口，只能在loop线程中调用
+
+    // 内核支持provided buffer ring时才能使用完成模式
+    bool completionSupported() const { return bufRing_ != nullptr; }
+    // 注册channel并开始multishot recv，收到数据、对端关闭或者出错时channel的读事件被触发
+    // channel->disableAll()会停止接收
+    void startRecv(Channel *channel);
+    // 把收到的数据追加到buf中，返回追加的字节数
+    // 接收已经结束（对端关闭或者出错）时*finished为true，出错时*saveErrno为错误码
+    size_t takeReceived(int fd, Buffer *buf, bool *finished, int *saveErrno);
+    // 在下次提交前把buf中的全部数据交给内核发送（和内部的缓冲区交换，不拷贝）
+    // 全部发送完成或者出错时channel的写事件被触发，完成之前不能再次调用
+    void requestSend(Channel *channel, ChainBuffer *buf);
+    // 取出发送结果，返回发送的字节数，出错返回-1并设置*saveErrno
+    ssize_t takeSent(int fd, int *saveErrno);
+
+private:
+    static const unsigned kRingEntries = 1024;
+    // 内部请求（删除poll）的user_data，完成项直接忽略
+    static const uint64_t kInternalUserData = ~uint64_t(0);
+    // provided buffer ring：kBufferCount个kBufferSize大小的接收缓冲区，数量必须是2的幂
+    static const unsigned kBufferCount = 512;
+    static const unsigned kBufferSize = 4096;
+    static const uint16_t kBufferGroup = 0;
+
+    // user_data中的请求类型
+    enum Op
+    {
+        kPollOp = 0,
+        kRecvOp = 1,
+        kSendOp = 2,
+    };
+
+    // 完成模式下每个连接的收发状态
+    struct IoState
+    {
+        IoState();
+
+        uint32_t recvGeneration;
+        bool recvWanted;        // 需要接收（startRecv之后，disableAll之前）
+        bool recvArmed;         // 内核中有multishot recv请求
+        bool recvFinished;      // 对端关闭或者出错，不再接收
+        int recvErrno;
+        std::vector<std::pair<uint16_t, uint32_t>> received;   // 还没取走的数据(缓冲区id, 长度)
+
+        uint32_t sendGeneration;
+        ChainBuffer *pendingSend;   // 等待在下次提交前发送的缓冲区（属于TcpConnection）
+        ChainBuffer sendBuffer;     // 正在发送的数据，请求完成之前内核会读取这块内存
+        // sendmsg请求的参数，提交时内核会拷贝一份，每次提交前重新填写
+        std::vector<struct iovec> sendIov;
+        struct msghdr sendMsg;
+        bool sendInFlight;
+        ssize_t sent;           // 本次已经发送的字节数
+        int sendErrno;
+    };
+
+    // 每个fd的注册状态，下标是fd
+    struct Registration
+    {
+        Registration();
+
+        Channel *channel;
+        uint32_t generation;    // 当前有效poll请求的代数
+        uint32_t armedEvents;   // 内核中正在等待的事件，0表示没有请求
+        bool dirty;             // 需要在下次提交前重新计算
+        int revents;            // 本轮poll收集到的事件
+        std::unique_ptr<IoState> io;
+    };
+
+    Registration& registration(int fd);
+    void markDirty(int fd);
+    // 把dirty的channel和内核中的请求同步
+    void flushDirty();
+    void arm(int fd, Registration &reg, uint32_t events);
+    void disarm(Registration &reg, int fd);
+
+    // 本轮有事件的channel只加入activeChannels一次，事件合并
+    void activate(Registration &reg, int revents, ChannelList *activeChannels);
+    void handlePollCompletion(int fd, uint32_t generation, int res, ChannelList *activeChannels);
+    void handleRecvCompletion(int fd, uint32_t generation, int res, uint32_t flags, ChannelList *activeChannels);
+    void handleSendCompletion(uint64_t userData, int fd, uint32_t generation, int res, ChannelList *activeChannels);
+
+    void setupBufferRing();
+    char* bufferAddr(uint16_t bid) { return &bufferPool_[static_cast<size_t>(bid) * kBufferSize]; }
+    // 把缓冲区还给内核
+    void recycleBuffer(uint16_t bid);
+    void armRecv(int fd, IoState &io);
+    void submitSend(int fd, IoState &io);
+    void stopRecv(int fd, IoState &io);
+    void cancel(uint64_t userData);
+
+    std::vector<char> bufferPool_;
+    io_uring_buf *bufRing_;        // provided buffer ring，共享给内核
+    size_t bufRingSize_;
+    uint16_t bufTail_;
+
+    std::vector<Registration> registrations_;
+    std::vector<int> dirtyFds_;
+    // channel删除时还在发送中的缓冲区，等对应的完成项返回后才能释放
+    std::map<uint64_t, std::unique_ptr<ChainBuffer>> orphanedSends_;
+
+    // 最后声明，最先析构：关闭io_uring之后内核不会再访问上面的缓冲区
+    IoUring ring_;
+};
+
+#endif // MUDUO_HAVE_IO_URING
@@ -1,9 +1,9 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
 
 #include "Timestamp.h"
+#include "ChannelTable.h"
 
 // 这里不需要实际类的大小，仅使用指针的可以使用这种前置声明
 class Channel;
@@ -16,6 +16,14 @@ public:
     // 一个poller对应多个channel（多路复用）
     using ChannelList = std::vector<Channel*>;
 
+    // IO复用的后端，kDefault按照环境变量选择（MUDUO_USE_IO_URING使用io_uring，否则epoll）
+    enum Backend
+    {
+        kDefault,
+        kEpoll,
+        kIoUring,
+    };
+
     Poller(EventLoop *loop);
 
     // 虚析构函数保证子类对象的正确析构
@@ -31,15 +39,17 @@ public:
     // 判断参数channel是否在当前Poller中
     bool hasChannel(Channel * channel) const;
 
+    // 合并修改后省掉的系统调用次数，任意线程读取，不合并修改的后端返回0
+    virtual uint64_t updatesSaved() const { return 0; }
+
     // EventLoop可以使用该接口获得默认的IO复用对象的具体实现（epoll、poll）
     // 这里由于Poller是基类，尽量不要包含子类头文件，故不再这里实现
-    static Poller* newDefaultPoller(EventLoop *loop);
+    static Poller* newDefaultPoller(EventLoop *loop, Backend backend = kDefault);
 
 protected:
-    // map的key是sockfd value是sockfd所属的channel通道
+    // 以sockfd为下标保存sockfd所属的channel通道和它在poller中的状态
     // channel是sockfd和对应感兴趣事件的封装
-    using ChannelMap = std::unordered_map<int, Channel*>;
-    ChannelMap channels_;
+    ChannelTable channels_;
 
 private:
     EventLoop *ownerLoop_;  // 定义poller所属的事件循环EventLoop
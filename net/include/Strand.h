@@ -0,0 +1,86 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "ThreadPool.h"
+#include "Callbacks.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class TcpConnection;
+
+/**
+ * 串行执行器（strand）：提交到同一个Strand的任务在线程池中按提交顺序一个接一个执行，
+ * 同一时刻最多占用一个工作线程，不同的Strand之间可以并行
+ * 每执行完一个任务就把自己重新投递到线程池，排在后面的其他任务也有机会执行
+ */
+class Strand : noncopyable, public std::enable_shared_from_this<Strand>
+{
+public:
+    using Task = ThreadPool::Task;
+    using IdleCallback = std::function<void()>;
+
+    explicit Strand(ThreadPool *pool);
+
+    // 任意线程提交任务
+    void post(Task task);
+    // 没有正在执行和等待执行的任务
+    bool idle() const;
+    // 执行完最后一个任务变成空闲时调用（在工作线程中，不持有Strand的锁）
+    void setIdleCallback(const IdleCallback &cb) { idleCallback_ = cb; }
+
+private:
+    friend class ConnectionExecutor;
+
+    // post分成两步：加入队列（返回是否需要投递到线程池）和投递，投递可能在当前线程中直接执行任务
+    bool enqueue(Task task);
+    void schedule();
+    void runNext();
+
+    ThreadPool *pool_;
+    mutable std::mutex mutex_;
+    std::deque<Task> tasks_;
+    bool running_;      // 已经投递到线程池或者正在执行
+    IdleCallback idleCallback_;
+};
+
+/**
+ * 按连接串行的执行器：每个连接一个Strand，同一个连接的请求按提交顺序在线程池中处理，
+ * 响应按请求顺序回到连接所属的loop中调用TcpConnection::send；不同连接之间并行
+ * 连接没有待处理的请求时对应的Strand会被释放
+ * 执行器可以先于线程池中还没有执行的任务析构：Strand只通过weak_ptr找回连接表，不会访问已经释放的执行器
+ */
+class ConnectionExecutor : noncopyable
+{
+public:
+    // 在工作线程中执行，返回值就是要发送给对端的响应，空字符串表示不发送
+    using Work = std::function<std::string()>;
+
+    explicit ConnectionExecutor(ThreadPool *pool);
+
+    // 通常在onMessage中调用
+    void dispatch(const TcpConnectionPtr &conn, Work work);
+    // 不产生响应的任务，和dispatch的任务一起按顺序执行
+    void post(const TcpConnectionPtr &conn, Strand::Task task);
+
+    // 当前有待处理请求的连接数
+    size_t activeConnections() const;
+
+private:
+    // 连接到Strand的映射，Strand的空闲回调通过weak_ptr访问
+    struct StrandMap
+    {
+        std::mutex mutex;
+        std::unordered_map<TcpConnection*, std::shared_ptr<Strand>> strands;
+    };
+
+    std::shared_ptr<Strand> strandOf(TcpConnection *conn);
+    static void release(const std::weak_ptr<StrandMap> &weakMap, TcpConnection *conn);
+
+    ThreadPool *pool_;
+    std::shared_ptr<StrandMap> map_;
+};
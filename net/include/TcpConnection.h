@@ -4,7 +4,9 @@
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
 #include "Timestamp.h"
+#include "TimingWheel.h"
 
 #include <memory> 
 #include <atomic>
@@ -59,7 +61,23 @@ public:
     void connectDestroyed();
 
     void send(const std::string &buf);
+    // 发送共享的数据，不拷贝：没能立即写出去的部分作为外部分片挂进发送缓冲区，写完之前持有data
+    // 适合大响应或者发给很多连接的同一份数据
+    void send(const std::shared_ptr<const std::string> &data);
     void shutdown();
+    void setTcpNoDelay(bool on);
+
+    // 设置空闲超时，seconds秒内没有读写则关闭连接，seconds <= 0表示取消
+    // 由所属loop的时间轮管理，handleRead和handleWrite会自动刷新
+    void setIdleTimeout(double seconds);
+
+    // 使用io_uring完成模式收发数据：multishot recv + provided buffer，send请求每轮批量提交
+    // 需要在连接建立（connectEstablished）之前设置，所属loop不是io_uring后端时退回就绪模式
+    void setCompletionMode(bool on) { completionMode_ = on; }
+    bool completionMode() const { return completionMode_; }
+
+    // 使用epoll边沿触发模式，需要在connectEstablished之前设置
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
 
     const InetAddress getLocalAddr() const { return localAddr_; }
     const InetAddress getPeerAddr() const { return peerAddr_; }
@@ -73,13 +91,31 @@ private:
     void handleClose();
     void handleError();
 
-    void sendInLooop(const void* message, size_t len);
+    // owner不为空时，没写出去的部分不拷贝，引用message并持有owner
+    void sendInLooop(const void* message, size_t len, std::shared_ptr<const void> owner = nullptr);
+    void sendInLooop(const std::string &message);
+    void sendSharedInLoop(const std::shared_ptr<const std::string> &data);
+    void appendOutput(const char *data, size_t len, std::shared_ptr<const void> owner);
     void shutdownInLoop();
 
+    // 完成模式下的收发，数据由IoUringPoller收发，这里只取结果
+    bool startCompletion();
+    void handleReadCompletion(Timestamp receiveTime);
+    void handleWriteCompletion();
+    void requestSendCompletion();
+
+    void setIdleTimeoutInLoop(double seconds);
+    void handleIdleTimeout();
+    // 有读写时刷新空闲超时
+    void refreshIdleTimeout();
+
     EventLoop *loop_;  // 这里不是baseLoop，因为TcpConnection都是在subLoop中管理的
     const std::string name_;
     std::atomic_int state_;
     bool reading_;
+    bool completionMode_;
+    bool edgeTriggered_;
+    bool sending_;      // 完成模式下有send请求还没有完成
 
     std::unique_ptr<Socket> socket_;
     std::unique_ptr<Channel> channel_;
@@ -95,5 +131,8 @@ private:
     size_t highWaterMark_;
 
     Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    ChainBuffer outputBuffer_;      // 分段的发送缓冲区，大响应不会整块扩容搬移
+
+    double idleTimeout_;                // 空闲超时时间，单位秒
+    TimingWheel::Entry idleEntry_;      // 挂在loop时间轮上的条目
 };
\ No newline at end of file
@@ -15,6 +15,8 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <mutex>
+#include <vector>
 
 // 对外的服务器编程的类
 class TcpServer : noncopyable
@@ -43,13 +45,67 @@ public:
     // 设置工作循环的个数
     void setThreadNum(int numThreads);
 
+    // 新连接在subLoop之间的分配策略（见EventLoopThreadPool::PlacementPolicy），默认轮询
+    // 只对mainLoop接收的连接有效，分片和共享监听时连接留在接收它的loop
+    void setPlacementPolicy(EventLoopThreadPool::PlacementPolicy policy) { threadPool_->setPlacementPolicy(policy); }
+
+    // subLoop线程的CPU/NUMA绑定（见EventLoopThreadPool::CpuPlacement），start()之前调用
+    void setCpuPlacement(EventLoopThreadPool::CpuPlacement placement, const std::vector<int> &cpus = std::vector<int>())
+    {
+        threadPool_->setCpuPlacement(placement, cpus);
+    }
+
+    // start()之后可以用来读取各个loop的负载统计
+    std::shared_ptr<EventLoopThreadPool> threadPool() const { return threadPool_; }
+
+    // 开启所有loop的忙轮询，start()之前调用
+    // loopSpinUs是每个loop的自旋预算，socketBusyPollUs > 0时同时给新连接设置SO_BUSY_POLL
+    void setBusyPoll(int loopSpinUs, int socketBusyPollUs = 0);
+
+    // 新连接使用io_uring完成模式收发数据（见TcpConnection::setCompletionMode）
+    // 只有loop使用io_uring后端（MUDUO_USE_IO_URING）时生效
+    void setCompletionMode(bool on) { completionMode_ = on; }
+
+    // 新连接使用epoll边沿触发模式：EPOLLIN|EPOLLOUT|EPOLLET只注册一次，收发都处理到EAGAIN
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+
+    // SO_REUSEPORT分片接收连接，start()之前调用，需要KReusePost选项并且setThreadNum > 0
+    // 每个subLoop有自己的Acceptor（独立的listen socket），由内核在socket之间分配连接，
+    // 新连接直接在接收它的loop中建立，不再经过mainLoop
+    // steerByCpu为true时挂上SO_ATTACH_REUSEPORT_CBPF，按处理SYN的CPU选择第(cpu % 线程数)个loop
+    // 配合setCpuPlacement(kCpuList, {0, 1, ...})把第i个loop绑定到第i个CPU，连接就由处理SYN的CPU上的loop接收
+    void setShardedAccept(bool on, bool steerByCpu = false);
+
+    // EPOLLEXCLUSIVE共享监听，start()之前调用，需要setThreadNum > 0
+    // 只有一个listen socket和一个accept队列，listenfd以EPOLLEXCLUSIVE注册到每个subLoop，
+    // 空闲的loop自己accept并建立连接，不受reuseport哈希不均的影响；和setShardedAccept互斥，后设置的生效
+    void setSharedAccept(bool on);
+
+    // 每次监听socket可读时最多accept的连接数，start()之前调用
+    void setAcceptBatch(int maxBatch) { acceptBatch_ = maxBatch; }
+
     // 开启服务器监听，也就是开启acceptor
     void start();
 
 private:
     using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+
+    // 新连接由谁accept
+    enum AcceptMode
+    {
+        kBaseLoopAccept,    // mainLoop的acceptor_接收，再轮询分给subLoop
+        kShardedAccept,     // 每个subLoop一个SO_REUSEPORT socket
+        kSharedAccept,      // 一个listenfd以EPOLLEXCLUSIVE注册到所有subLoop
+    };
     
-    void newConnection(int sockfd, const InetAddress &peerAddr);
+    // 一批新连接，ioLoop为nullptr时轮询分给subLoop，否则（subLoop自己接收）全部交给ioLoop
+    // 每个subLoop只投递一次回调
+    void newConnections(EventLoop *ioLoop, const Acceptor::AcceptedList &accepted);
+    TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    // 在ioLoop线程中建立这一批连接
+    static void establishConnections(const std::vector<TcpConnectionPtr> &conns);
+    void startShards();
+    void startShared();
     void removeConnction(const TcpConnectionPtr &conn);
     void removeConnctionInLoop(const TcpConnectionPtr & conn);
 
@@ -57,8 +113,13 @@ private:
 
     const std::string ipPort_;
     const std::string name_;  // 服务器的名称
+    const InetAddress listenAddr_;
+    const bool reusePort_;
+    const std::string connNamePrefix_;  // name_-ipPort_#，后面加上连接编号就是连接的名称
+    const bool wildcardListen_;         // 监听的是INADDR_ANY，本端地址只能通过getsockname得到
 
     std::unique_ptr<Acceptor> acceptor_;            // 运行在mainLoop，监听新连接
+    std::vector<std::unique_ptr<Acceptor>> shardAcceptors_;    // 分片接收时每个subLoop一个
 
     std::shared_ptr<EventLoopThreadPool> threadPool_;  // one loop per thread
 
@@ -69,6 +130,14 @@ private:
     ThreadInitCallback threadInitCallback_;         // loop线程初始化
     std::atomic_int started_;
 
-    int nextConnId_;
+    std::atomic_int nextConnId_;
+    int busyPollUs_;                // loop的自旋预算
+    int socketBusyPollUs_;          // 新连接的SO_BUSY_POLL
+    bool completionMode_;           // 新连接是否使用完成模式
+    bool edgeTriggered_;            // 新连接是否使用边沿触发
+    AcceptMode acceptMode_;
+    bool steerByCpu_;               // 分片时按CPU选择socket
+    int acceptBatch_;               // 每次可读事件最多accept的连接数
+    std::mutex connectionsMutex_;   // subLoop自己接收连接时多个loop线程会同时增删连接
     ConnectionMap connections_;     // 保存所有的连接
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InplaceFunction.h"
+#include "EventLoop.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class Thread;
+
+/**
+ * 计算线程池，用于把MessageCallback中耗CPU的工作（解压、解析、加解密）移出IO线程
+ * 每个工作线程有自己的任务队列：自己从队尾取（后进先出，缓存更热），
+ * 空闲时随机挑选其他线程从队头偷任务；工作线程中提交的任务放进自己的队列，其他线程提交的轮流分给各个工作线程
+ *
+ * 带continuation的任务执行完之后，通过runInLoop把continuation投递回指定的EventLoop执行，
+ * 结果在连接所属的loop中使用，用户不需要加锁
+ */
+class ThreadPool : noncopyable
+{
+public:
+    // 只能移动，捕获不超过64字节时不会在堆上分配
+    using Task = InplaceFunction<void(), 64>;
+    using ThreadInitCallback = std::function<void()>;
+
+    explicit ThreadPool(const std::string &name = std::string("ThreadPool"));
+    ~ThreadPool();
+
+    // start之前调用
+    void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+
+    // 只能调用一次，stop之后也不能重新start
+    void start();
+    // 执行完已经提交的任务后退出所有工作线程，不能和run并发调用
+    void stop();
+
+    // 任意线程提交任务，numThreads为0或者已经stop时直接在当前线程执行
+    void run(Task task);
+
+    // 在池中执行work，完成后在loop线程中执行continuation
+    void run(Task work, EventLoop *loop, EventLoop::Functor continuation);
+
+    // 在池中执行work，完成后在loop线程中以work的返回值调用continuation（work不能返回void）
+    template <typename Work, typename Continuation>
+    void submit(EventLoop *loop, Work work, Continuation continuation)
+    {
+        run(ContinuationTask<Work, Continuation>(loop, std::move(work), std::move(continuation)));
+    }
+
+    const std::string& name() const { return name_; }
+    int numThreads() const { return numThreads_; }
+
+    // 统计，任意线程读取：执行的任务数、从其他线程偷到的任务数
+    uint64_t tasksRun() const { return tasksRun_.load(std::memory_order_relaxed); }
+    uint64_t tasksStolen() const { return tasksStolen_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    template <typename Work, typename Continuation>
+    struct ContinuationTask
+    {
+        ContinuationTask(EventLoop *l, Work w, Continuation c)
+            : loop(l), work(std::move(w)), continuation(std::move(c)) {}
+
+        void operator()()
+        {
+            loop->runInLoop(std::bind(std::move(continuation), work()));
+        }
+
+        EventLoop *loop;
+        Work work;
+        Continuation continuation;
+    };
+
+    void threadFunc(int index);
+    // 依次尝试自己的队列和偷其他线程的任务，都没有返回false
+    bool takeTask(int index, uint32_t *seed, Task *task);
+    bool stealTask(int victim, Task *task);
+
+    std::string name_;
+    int numThreads_;
+    ThreadInitCallback threadInitCallback_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::unique_ptr<Thread>> threads_;
+    std::atomic<uint32_t> nextWorker_;      // 外部线程提交时轮流选择的队列
+
+    // 所有队列中的任务总数，空闲线程根据它决定是否睡眠
+    std::atomic<int64_t> pending_;
+    std::atomic_int sleepers_;
+    std::mutex sleepMutex_;
+    std::condition_variable wakeCond_;
+    std::atomic_bool running_;
+
+    std::atomic<uint64_t> tasksRun_;
+    std::atomic<uint64_t> tasksStolen_;
+};
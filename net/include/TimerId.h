@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+/**
+ * 对外暴露的定时器标识，用于EventLoop::cancel取消定时器
+ * 这里同时保存了Timer的指针和序号，避免Timer被释放后地址被复用导致误删
+ */
+class TimerId
+{
+public:
+    TimerId()
+        : timer_(nullptr)
+        , sequence_(0)
+    {}
+
+    TimerId(Timer *timer, int64_t seq)
+        : timer_(timer)
+        , sequence_(seq)
+    {}
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+
+#include <set>
+#include <vector>
+#include <utility>
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+/**
+ * 定时器队列，使用timerfd把定时事件和IO事件统一到Poller中
+ * timerfd总是设置为最早到期的定时器的时间，到期后一次取出所有到期的定时器
+ * 
+ * timers_按照到期时间排序（插入、删除都是O(log n)）
+ * activeTimers_按照Timer地址排序，用于cancel的查找
+ */
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 添加定时器，线程安全，可以在其他线程中调用
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+
+    // 取消定时器，线程安全
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+
+    // timerfd可读的时候调用
+    void handleRead();
+    // 取出所有到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 重复定时器重新加入队列，一次性定时器释放
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+
+    // 插入定时器，返回最早到期的时间是否改变
+    bool insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    TimerList timers_;
+
+    ActiveTimerSet activeTimers_;
+    bool callingExpiredTimers_;         // 是否正在执行到期定时器的回调
+    ActiveTimerSet cancelingTimers_;    // 回调执行过程中被取消的定时器
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TimerId.h"
+
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+
+class EventLoop;
+
+/**
+ * 分层时间轮，用于大量连接的空闲超时
+ * 每个连接一个堆定时器，每次读写都要O(log n)的删除和插入，连接数很多时开销太大
+ * 时间轮中touch和到期都是O(1)：条目是侵入式双向链表的节点，只需要摘下再挂到新的槽上
+ * 
+ * 共kLevels层，每层kSlots个槽，第i层一个槽覆盖 kSlots^i 个tick
+ * 第0层的槽到期时执行回调，高层的槽在低层转完一圈时向下层逐级迁移（cascade）
+ * 由所属EventLoop的runEvery定时器驱动，只能在loop线程中使用
+ */
+class TimingWheel : noncopyable
+{
+public:
+    using ExpireCallback = std::function<void()>;
+
+    // 侵入式链表节点，槽的表头也使用这个结构
+    struct Node
+    {
+        Node *prev;
+        Node *next;
+    };
+
+    // 嵌入到使用者对象中（例如TcpConnection）的时间轮条目
+    class Entry : private Node, noncopyable
+    {
+    public:
+        Entry();
+        ~Entry();   // 析构时自动从时间轮上摘下
+
+        void setCallback(ExpireCallback cb) { callback_ = std::move(cb); }
+        bool linked() const { return prev != nullptr; }
+
+    private:
+        friend class TimingWheel;
+
+        TimingWheel *wheel_;    // 当前所在的时间轮
+        uint64_t expireTick_;   // 到期的tick
+        ExpireCallback callback_;
+    };
+
+    TimingWheel(EventLoop *loop, double tickSeconds = 1.0);
+    ~TimingWheel();
+
+    // 刷新条目的超时时间，不在时间轮上则加入，O(1)
+    void touch(Entry *entry, double timeoutSeconds);
+    // 从时间轮上摘下条目，O(1)
+    void remove(Entry *entry);
+
+    size_t size() const { return size_; }
+    double tickSeconds() const { return tickSeconds_; }
+
+private:
+    static const int kLevelBits = 6;
+    static const int kSlots = 1 << kLevelBits;  // 每层64个槽
+    static const int kLevels = 4;               // 最大 64^4 个tick
+
+    // 定时器驱动，时间前进一个tick
+    void tick();
+    // 将level层当前的槽迁移到低层
+    void cascade(int level);
+    // 按照到期tick将条目挂到对应的槽上
+    void place(Entry *entry);
+
+    static void listInit(Node *head);
+    static void listAppend(Node *head, Node *node);
+    static void listUnlink(Node *node);
+
+    EventLoop *loop_;
+    const double tickSeconds_;
+    uint64_t currentTick_;
+    size_t size_;
+    TimerId tickTimer_;
+    Node slots_[kLevels][kSlots];
+};
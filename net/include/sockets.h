@@ -45,6 +45,14 @@ void setReusePort(int sockfd);
 // 设置SO_KEEPALIVE，TCP心跳保活
 void setKeepAlive(int sockfd);
 
+// 设置SO_BUSY_POLL和SO_PREFER_BUSY_POLL，读socket时在网卡队列上忙轮询usec微秒（低延迟场景）
+// 超过net.core.busy_read需要CAP_NET_ADMIN权限
+void setBusyPoll(int sockfd, int usec);
+
+// 给SO_REUSEPORT组挂一个CBPF程序：按处理SYN的CPU选择组内第(cpu % numSockets)个socket
+// 组内的下标就是各个socket调用listen的顺序，需要在listen之前设置
+bool attachReuseportCpuSteering(int sockfd, int numSockets);
+
 // IPv4专属 地址类型强转工具函数
 const struct sockaddr* sockaddr_cast(const struct sockaddr_in* addr);
 struct sockaddr* sockaddr_cast(struct sockaddr_in* addr);
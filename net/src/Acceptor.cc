@@ -1,11 +1,14 @@
 #include "Acceptor.h"
 #include "Logger.h"
 #include "InetAddress.h"
+#include "EventLoop.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 
 // 这里创建的都是非阻塞fd也就是muduo库的精髓
 static int createNonBlocking()
@@ -23,6 +26,8 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
     , acceptSocket_(createNonBlocking())
     , acceptChannel_(loop, acceptSocket_.fd())
     , listenning_(false)
+    , acceptBatch_(kDefaultAcceptBatch)
+    , idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
     acceptSocket_.setReuseAddr(true);
     acceptSocket_.setReusePort(reuseport);
@@ -33,42 +38,121 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
 }
 Acceptor::~Acceptor()
 {   
+    stopShared();
     // 将里面的连接全部删除
     acceptChannel_.disableAll();
     // 将自己remove
     acceptChannel_.remove();
+    ::close(idleFd_);
 }
 
 void Acceptor::listen()
+{
+    if (!listenning_)
+    {
+        listenSocket();
+    }
+    acceptChannel_.enableReading();  // acceptChannel_ => Poller
+}
+
+void Acceptor::listenSocket()
 {
     listenning_ = true;
     acceptSocket_.listen();  // 监听
-    acceptChannel_.enableReading();  // acceptChannel_ => Poller
+}
+
+void Acceptor::listenShared(EventLoop *ioLoop, const NewConnectionCallback &cb)
+{
+    if (!listenning_)
+    {
+        listenSocket();
+    }
+    Channel *channel = new Channel(ioLoop, acceptSocket_.fd());
+    channel->setExclusive(true);
+    channel->setReadCallback(std::bind(&Acceptor::acceptBatch, this, cb));
+    sharedChannels_.push_back(std::unique_ptr<Channel>(channel));
+    ioLoop->runInLoop(std::bind(&Channel::enableReading, channel));
+}
+
+void Acceptor::stopShared()
+{
+    for (std::unique_ptr<Channel> &channel : sharedChannels_)
+    {
+        Channel *ptr = channel.get();
+        ptr->ownerLoop()->runInLoopAndWait([ptr]() {
+            ptr->disableAll();
+            ptr->remove();
+        });
+    }
+    sharedChannels_.clear();
 }
 
 // 每当有新用户连接就会执行，这个函数设置成channel中的回调函数
 void Acceptor::handleRead()
+{
+    acceptBatch(newConnectionCallback_);
+}
+
+void Acceptor::acceptBatch(const NewConnectionCallback &cb)
 {   
+    AcceptedList accepted;
+    accepted.reserve(acceptBatch_);
     // 这里InetAddress没有空的默认构造函数需要加一个端口号或者一个地址
     InetAddress peerAddr;
-    // 建立连接得到新建的文件描述符，并将socket详细地址和端口写入peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd > 0)
+    while (static_cast<int>(accepted.size()) < acceptBatch_)
     {
-        if (newConnectionCallback_) 
+        // 建立连接得到新建的文件描述符，并将socket详细地址和端口写入peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd >= 0)
         {
-            newConnectionCallback_(connfd, peerAddr);   // 轮询找到subLoop，唤醒并分发当前的新客户端的Channel
+            accepted.push_back(Accepted{connfd, peerAddr});
+            continue;
         }
-        else
+        int savedErrno = errno;
+        if (savedErrno == EINTR || savedErrno == ECONNABORTED)
         {
-            ::close(connfd);
+            continue;
         }
-    }
-    else{
-        LOG_ERROR("%s:%s:%d accept error:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if (errno == EMFILE)
+        if (savedErrno == EMFILE || savedErrno == ENFILE)
         {
             LOG_ERROR("%s:%s:%d sockfd reached limit! \n", __FILE__, __FUNCTION__, __LINE__);
+            dropOnEmfile();
+        }
+        else if (savedErrno != EAGAIN)   // 共享监听时别的loop可能已经把连接取走了
+        {
+            LOG_ERROR("%s:%s:%d accept error:%d \n", __FILE__, __FUNCTION__, __LINE__, savedErrno);
         }
+        break;
+    }
+    if (accepted.empty())
+    {
+        return;
     }
-}
\ No newline at end of file
+    if (cb) 
+    {
+        cb(accepted);   // 找到subLoop，唤醒并分发这一批新客户端的Channel
+    }
+    else
+    {
+        for (const Accepted &item : accepted)
+        {
+            ::close(item.sockfd);
+        }
+    }
+}
+
+void Acceptor::dropOnEmfile()
+{
+    std::unique_lock<std::mutex> lock(idleFdMutex_);
+    if (idleFd_ < 0)
+    {
+        return;
+    }
+    ::close(idleFd_);
+    idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
+    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
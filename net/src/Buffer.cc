@@ -1,15 +1,32 @@
 #include "Buffer.h"
 
+#include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+const size_t Buffer::kMinReadHint;
+const size_t Buffer::kMaxReadHint;
+
+// 每个线程一块溢出缓冲区，读到的数据超过Buffer的可写空间时暂存在这里，不需要每次清零
+static __thread char t_extrabuf[65536];
+
+// 缓冲区为空且可写空间超过readHint_的这么多倍时，释放多余的空间
+static const size_t kShrinkFactor = 4;
+
 /**
  *  从fd上读取数据，Poller工作在LT模式上  
  *  Buffer缓冲区是有大小的，但是从fd上读取的时候，不确定数据大小
+ *  先按照readHint_准备可写空间，大部分数据直接读进Buffer，剩下的读进溢出缓冲区再append
  */ 
 ssize_t Buffer::readFd(int fd, int* saveErrno)
 {       
-    char extrabuf[65535] = {0};  // 开辟在栈上的空间 64K，这个空间是自动释放的
+    if (readableBytes() == 0 && writableBytes() > kShrinkFactor * readHint_)
+    {
+        // 大流量过后连接空闲下来，把缓冲区缩回去，不会拷贝数据
+        shrink(readHint_);
+    }
+    ensureWritableBytes(readHint_);
+
     struct iovec vec[2];
 
     // Buffer底层缓冲区剩余可写大小
@@ -17,10 +34,10 @@ ssize_t Buffer::readFd(int fd, int* saveErrno)
     vec[0].iov_base = begin() + writerIndex_;
     vec[0].iov_len = writable;
 
-    vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    vec[1].iov_base = t_extrabuf;
+    vec[1].iov_len = sizeof t_extrabuf;
 
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    const int iovcnt = (writable < sizeof t_extrabuf) ? 2 : 1;
     // 从fd上读取的数据
     const ssize_t n = ::readv(fd, vec, iovcnt);
 
@@ -28,19 +45,44 @@ ssize_t Buffer::readFd(int fd, int* saveErrno)
     {
         *saveErrno = errno;
     }
-    else if (n <= writable)     // 原始buffer够写
+    else if (static_cast<size_t>(n) <= writable)     // 原始buffer够写
     {
         writerIndex_ += n;
     }
     else{
         // 数据大于原本的缓冲区写区大小
         writerIndex_ = buffer_.size();
-        // 将额外空间的数据写入buffer中，结束后额外空间自动释放
-        append(extrabuf, n - writable);
+        // 将溢出缓冲区的数据写入buffer中
+        append(t_extrabuf, n - writable);
+    }
+    if (n > 0)
+    {
+        adjustReadHint(n);
     }
     return n;
 }
 
+// 读满了就加倍，连续两次不到一半才减半，避免在两个大小之间来回抖动
+void Buffer::adjustReadHint(size_t n)
+{
+    if (n >= readHint_)
+    {
+        readHint_ = std::min(readHint_ * 2, kMaxReadHint);
+        smallReads_ = 0;
+    }
+    else if (n <= readHint_ / 2)
+    {
+        if (++smallReads_ >= 2)
+        {
+            readHint_ = std::max(readHint_ / 2, kMinReadHint);
+            smallReads_ = 0;
+        }
+    }
+    else
+    {
+        smallReads_ = 0;
+    }
+}
 
 // 向fd中写
 ssize_t Buffer::writeFd(int fd, int* saveErrno)
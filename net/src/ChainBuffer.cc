@@ -0,0 +1,180 @@
+#include "ChainBuffer.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+
+const size_t ChainBuffer::kBlockSize;
+
+struct ChainBuffer::Block
+{
+    Block *next;        // 在空闲链表中时使用
+    char data[kBlockSize];
+};
+
+// 每个线程缓存的空闲内存块，超过上限的直接释放
+static const size_t kMaxFreeBlocks = 64;
+static __thread ChainBuffer::Block *t_freeBlocks = nullptr;
+static __thread size_t t_numFreeBlocks = 0;
+
+ChainBuffer::ChainBuffer()
+    : readable_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+    retrieveAll();
+}
+
+void ChainBuffer::swap(ChainBuffer &rhs)
+{
+    segments_.swap(rhs.segments_);
+    std::swap(readable_, rhs.readable_);
+}
+
+ChainBuffer::Block* ChainBuffer::allocBlock()
+{
+    Block *block = t_freeBlocks;
+    if (block != nullptr)
+    {
+        t_freeBlocks = block->next;
+        --t_numFreeBlocks;
+        return block;
+    }
+    return new Block;
+}
+
+void ChainBuffer::freeBlock(Block *block)
+{
+    if (t_numFreeBlocks >= kMaxFreeBlocks)
+    {
+        delete block;
+        return;
+    }
+    block->next = t_freeBlocks;
+    t_freeBlocks = block;
+    ++t_numFreeBlocks;
+}
+
+size_t ChainBuffer::tailWritable() const
+{
+    if (segments_.empty() || segments_.back().block == nullptr)
+    {
+        return 0;
+    }
+    const Segment &tail = segments_.back();
+    return tail.block->data + kBlockSize - (tail.data + tail.len);
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    readable_ += len;
+    // 先填满最后一块的空闲部分，剩下的放进新的块
+    size_t n = std::min(tailWritable(), len);
+    if (n > 0)
+    {
+        Segment &tail = segments_.back();
+        ::memcpy(const_cast<char*>(tail.data + tail.len), data, n);
+        tail.len += n;
+        data += n;
+        len -= n;
+    }
+    while (len > 0)
+    {
+        Block *block = allocBlock();
+        n = std::min(kBlockSize, len);
+        ::memcpy(block->data, data, n);
+        segments_.push_back(Segment{block->data, n, block, nullptr});
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::appendExternal(const char *data, size_t len, std::shared_ptr<const void> owner)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    readable_ += len;
+    segments_.push_back(Segment{data, len, nullptr, std::move(owner)});
+}
+
+void ChainBuffer::appendExternal(const std::shared_ptr<const std::string> &str, size_t offset)
+{
+    if (offset > str->size())
+    {
+        // 越界的分片会让writev读到字符串之外的内存
+        LOG_ERROR("ChainBuffer::appendExternal offset %zu out of range, size %zu \n", offset, str->size());
+        return;
+    }
+    appendExternal(str->data() + offset, str->size() - offset, str);
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    if (len >= readable_)
+    {
+        retrieveAll();
+        return;
+    }
+    readable_ -= len;
+    while (len > 0)
+    {
+        Segment &front = segments_.front();
+        if (len < front.len)
+        {
+            front.data += len;
+            front.len -= len;
+            return;
+        }
+        len -= front.len;
+        if (front.block != nullptr)
+        {
+            freeBlock(front.block);
+        }
+        segments_.pop_front();
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    for (Segment &segment : segments_)
+    {
+        if (segment.block != nullptr)
+        {
+            freeBlock(segment.block);
+        }
+    }
+    segments_.clear();
+    readable_ = 0;
+}
+
+int ChainBuffer::fillIovec(struct iovec *iov, int maxIov) const
+{
+    int n = 0;
+    for (std::deque<Segment>::const_iterator it = segments_.begin();
+         it != segments_.end() && n < maxIov; ++it, ++n)
+    {
+        iov[n].iov_base = const_cast<char*>(it->data);
+        iov[n].iov_len = it->len;
+    }
+    return n;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno)
+{
+    struct iovec vec[IOV_MAX];
+    int iovcnt = fillIovec(vec, IOV_MAX);
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n <= 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
@@ -8,13 +8,16 @@
 const int Channel::kNoneEvent = 0;
 const int Channel::kReadEvent = EPOLLIN | EPOLLPRI;
 const int Channel::kWriteEvent = EPOLLOUT;
+const int Channel::kEdgeEvent = EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLET;
+const int Channel::kExclusiveEvent = EPOLLEXCLUSIVE;
 
 Channel::Channel(EventLoop *loop, int fd) 
     : loop_(loop)
     , fd_(fd)
     , events_(0)
     , revents_(0)
-    , index_(-1)
+    , edgeTriggered_(false)
+    , exclusive_(false)
     , tied_(false)
 {
 }
@@ -27,6 +30,17 @@ Channel::~Channel()
      */
 }
 
+int Channel::pollEvents() const
+{
+    int events = edgeTriggered_ ? kEdgeEvent : events_;
+    if (exclusive_)
+    {
+        // EPOLLEXCLUSIVE只能和EPOLLIN/EPOLLOUT/EPOLLET等一起使用，带EPOLLPRI会EINVAL
+        events = (events & ~EPOLLPRI) | kExclusiveEvent;
+    }
+    return events;
+}
+
 // 将连接和channel绑定在一起，防止channel被手动remove掉，
 void Channel::tie(const std::shared_ptr<void>& obj) 
 {   
@@ -92,7 +106,8 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
         }
     }
 
-    if (revents_ & (EPOLLIN | EPOLLPRI))
+    // 边沿触发时读写事件一直是注册的，没有打开的事件不需要处理
+    if ((revents_ & (EPOLLIN | EPOLLPRI)) && (!edgeTriggered_ || isReading()))
     {
         if (readCallback_)
         {
@@ -100,7 +115,7 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
         }
     }
 
-    if (revents_ & EPOLLOUT) 
+    if ((revents_ & EPOLLOUT) && (!edgeTriggered_ || isWriting()))
     {
         if (writeCallback_)
         {
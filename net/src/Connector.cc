@@ -9,7 +9,7 @@
 #include <unistd.h>
 #include <functional>
 #include <strings.h>
-#include <thread>
+#include <algorithm>
 
 const int Connector::kInitRetryDelayMs;
 const int Connector::kMaxRetryDelayMs;
@@ -29,6 +29,7 @@ Connector::~Connector()
 {
     LOG_INFO("Connector destroyed");
     stop();
+    loop_->cancel(timerId_);
 }
 
 void Connector::start()
@@ -57,6 +58,7 @@ void Connector::startInLoop()
 void Connector::stop()
 {
     connect_ = false;
+    loop_->cancel(timerId_);    // 取消还未触发的重连定时器
     loop_->queueInLoop(std::bind(&Connector::stopInLoop, this));
 }
 
@@ -207,14 +209,9 @@ void Connector::retry(int sockfd)
         LOG_INFO("Connector::retry - Retry connecting to %s in %d ms",
                  serverAddr_.toIpPort().c_str(), retryDelayMs_);
 
-        int delayMs = this->retryDelayMs_;
-        this->retryDelayMs_ = std::min(this->retryDelayMs_ * 2, Connector::kMaxRetryDelayMs);
-        std::thread([this, delayMs]() {
-            // 睡眠指定毫秒数，不阻塞IO线程的EventLoop
-            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
-            // 睡醒后，投递任务到IO线程执行，保证所有操作在单一线程
-            loop_->runInLoop(std::bind(&Connector::startInLoop, this));
-        }).detach(); // 线程执行完毕自动销毁，无内存泄漏，无join阻塞
+        // 通过EventLoop的定时器延迟重连，不再额外创建线程睡眠
+        timerId_ = loop_->runAfter(retryDelayMs_ / 1000.0,
+            std::bind(&Connector::startInLoop, this));
         retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
     }
     else
@@ -1,18 +1,37 @@
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
+#include "Logger.h"
 
 #include <stdlib.h>
 
-Poller* Poller::newDefaultPoller(EventLoop *loop)
+Poller* Poller::newDefaultPoller(EventLoop *loop, Backend backend)
 {
-    if (::getenv("MUDUO_USE_POLL"))
+    if (backend == kDefault)
     {
-        // LOG_INFO("Poller::newDefaultPoller use Poll \n");
-        return nullptr;
+        if (::getenv("MUDUO_USE_POLL"))
+        {
+            // LOG_INFO("Poller::newDefaultPoller use Poll \n");
+            return nullptr;
+        }
+        backend = ::getenv("MUDUO_USE_IO_URING") ? kIoUring : kEpoll;
     }
-    else 
+
+    if (backend == kIoUring)
     {
-        // LOG_INFO("Poller::newDefaultPoller use Epoll \n");
-        return new EPollPoller(loop);
+#ifdef MUDUO_HAVE_IO_URING
+        IoUringPoller *poller = new IoUringPoller(loop);
+        if (poller->valid())
+        {
+            return poller;
+        }
+        delete poller;
+        LOG_ERROR("Poller::newDefaultPoller io_uring unavailable, fall back to epoll \n");
+#else
+        LOG_ERROR("Poller::newDefaultPoller built without io_uring, fall back to epoll \n");
+#endif
     }
+
+    // LOG_INFO("Poller::newDefaultPoller use Epoll \n");
+    return new EPollPoller(loop);
 }
\ No newline at end of file
@@ -6,19 +6,17 @@
 #include "Logger.h"
 #include "Channel.h"
 
-
-// 标识一个channel的状态
-// channel未添加到poller
-const int kNew = -1;    // channel的成员index_ = -1;
-// channel已经添加到poller
-const int kAdded = 1;
-// channel从poller中删除
-const int kDeleted = 2;
+// channel的状态（未添加、已添加、已删除）保存在channels_中，以fd为下标
+const int kNew = ChannelTable::kNew;
+const int kAdded = ChannelTable::kAdded;
+const int kDeleted = ChannelTable::kDeleted;
 
 EPollPoller::EPollPoller(EventLoop *loop)
     : Poller(loop)
     , epollfd_(::epoll_create1(EPOLL_CLOEXEC))
     , events_(kInitEventListSize)   // vector<epoll_event>
+    , updatesRequested_(0)
+    , updatesIssued_(0)
 {
     if (epollfd_ < 0) 
     {
@@ -34,6 +32,7 @@ EPollPoller::~EPollPoller()
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 {   
     LOG_INFO("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
+    flushUpdates();
     int numEvents = ::epoll_wait(epollfd_, 
                                 &*events_.begin(), 
                                 static_cast<int>(events_.size()), 
@@ -45,7 +44,7 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
     {
         LOG_INFO("%d envetns happend \n", numEvents);
         fillActiveChannels(numEvents, activeChannels);
-        if (numEvents == events_.size())
+        if (static_cast<size_t>(numEvents) == events_.size())
         {
             events_.resize(events_.size() * 2);
         }
@@ -69,52 +68,88 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 /**
  *                      EventLoop
  *     ChannelList（all）               Poller
- *                            ChannelMap <fd, channel*> (part)
+ *                            ChannelTable <fd, channel*> (part)
  */
 
 // channel update => EventLoop updateChannel => Poller updateChannel
+// 只修改channel的状态，epoll_ctl推迟到下一次poll之前
 void EPollPoller::updateChannel(Channel* channel)
 {
-    // 这里的index就是上面的三个状态（未添加、已添加、已删除）
-    const int index = channel->index();
-    LOG_INFO("fd=%d evetns=%d index=%d \n", channel->fd(), channel->events(), index);
+    int fd = channel->fd();
+    // 一次下标访问同时拿到channel和它的状态
+    ChannelTable::Entry &entry = channels_.add(fd, channel);
+    const int index = entry.state;
+    LOG_INFO("fd=%d evetns=%d index=%d \n", fd, channel->events(), index);
 
-    if (index == kNew || index == kDeleted)
+    // 统计立即提交时这次修改会产生的epoll_ctl（ADD/DEL/MOD）
+    if (index != kAdded || channel->isNoneEvent()
+        || (!channel->edgeTriggered() && !channel->exclusive()))
     {
-        if (index == kNew) 
-        {
-            int fd = channel->fd();
-            channels_[fd] = channel;
-        }
+        updatesRequested_.fetch_add(1, std::memory_order_relaxed);
+    }
+    entry.state = channel->isNoneEvent() ? kDeleted : kAdded;
 
-        channel->set_index(kAdded);
-        update(EPOLL_CTL_ADD, channel);
-    } 
-    else    // 已经注册过了
+    if (!entry.dirty)
     {
-        int fd = channel->fd();
-        if (channel->isNoneEvent())
-        {
-            update(EPOLL_CTL_DEL, channel);
-            channel->set_index(kDeleted);
-        } 
-        else 
-        {   
-            update(EPOLL_CTL_MOD, channel);
-        }
+        entry.dirty = true;
+        dirtyFds_.push_back(fd);
     }
 }
 
 void EPollPoller::removeChannel(Channel* channel)
 {
     int fd = channel->fd();
-    channels_.erase(fd);
-    int index = channel->index();
-    if (index == kAdded)
+    ChannelTable::Entry *entry = channels_.find(fd);
+    if (entry != nullptr && entry->state == kAdded)
+    {
+        updatesRequested_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // 调用者接下来会关闭fd，不能推迟；还没有提交给内核的话什么都不用做
+    if (entry != nullptr && entry->registered)
     {
         update(EPOLL_CTL_DEL, channel);
     }
-    channel->set_index(kNew);
+    // 表项清空后dirtyFds_中残留的fd会被跳过
+    channels_.remove(fd);
+}
+
+void EPollPoller::flushUpdates()
+{
+    for (int fd : dirtyFds_)
+    {
+        ChannelTable::Entry *entry = channels_.find(fd);
+        if (entry == nullptr || !entry->dirty)
+        {
+            continue;
+        }
+        entry->dirty = false;
+
+        Channel *channel = entry->channel;
+        if (entry->state != kAdded)
+        {
+            if (entry->registered)
+            {
+                update(EPOLL_CTL_DEL, channel);
+                entry->registered = false;
+            }
+            continue;
+        }
+
+        uint32_t events = static_cast<uint32_t>(channel->pollEvents());
+        if (!entry->registered)
+        {
+            update(EPOLL_CTL_ADD, channel);
+            entry->registered = true;
+            entry->kernelEvents = events;
+        }
+        else if (events != entry->kernelEvents && !channel->edgeTriggered() && !channel->exclusive())
+        {   
+            // 边沿触发注册的事件是固定的，读写的开关不需要epoll_ctl，EPOLLEXCLUSIVE不允许MOD
+            update(EPOLL_CTL_MOD, channel);
+            entry->kernelEvents = events;
+        }
+    }
+    dirtyFds_.clear();
 }
 
 void EPollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
@@ -134,10 +169,10 @@ void EPollPoller::update(int operation, Channel *channel)
     epoll_event event;
     memset(&event, 0, sizeof event);
     int fd = channel->fd();
-    event.events = channel->events();
+    event.events = channel->pollEvents();
     // event.data.fd = fd;
     event.data.ptr = channel; // 这里通过epolldata携带数据，联合体选的是ptr
-    
+    updatesIssued_.fetch_add(1, std::memory_order_relaxed);
 
     if (::epoll_ctl(epollfd_, operation, fd, & event) < 0)
     {
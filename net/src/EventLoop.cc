@@ -2,11 +2,18 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include "IoUringPoller.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <memory>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <time.h>
 
 // 防止一个线程创建多个EventLoop，__thread就是控制这个全局变量每个线程中有自己的一份（thread_local）
 __thread EventLoop *t_loopInThisThread= nullptr;
@@ -14,6 +21,17 @@ __thread EventLoop *t_loopInThisThread= nullptr;
 // 定义默认的Poller IO复用接口的超时时间
 const int kPollTimeMs = 10000;
 
+// 自旋预算的下限，连续落空时减半不会低于这个值
+const int kMinBusyPollUs = 1;
+
+// 单调时钟，单位微秒，用于计算自旋的时间
+static int64_t monotonicMicros()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 // 创建wakeupfd，用来唤醒notify唤醒subReactor处理新来的channel
 int createEventfd()
 {
@@ -25,14 +43,31 @@ int createEventfd()
     return evtfd;
 }
 
-EventLoop::EventLoop()
+EventLoop::EventLoop(Poller::Backend backend)
     : looping_(false)
     , quit_(false)
     , callingPendingFunctors_(false)
     , threadId_(CurrentThread::tid())
-    , poller_(Poller::newDefaultPoller(this))
+    , poller_(Poller::newDefaultPoller(this, backend))
+    , ioUringPoller_(nullptr)
+    , numaNode_(-1)
+    , timerQueue_(new TimerQueue(this))
     , wakeupFd_(createEventfd())
     , wakeupChannel_(new Channel(this, wakeupFd_))
+    , wakeupPending_(false)
+    , wakeupsIssued_(0)
+    , wakeupsSuppressed_(0)
+    , busyPollUs_(0)
+    , busyPollBudgetUs_(0)
+    , busyPollSpins_(0)
+    , busyPollHits_(0)
+    , busyPollSleeps_(0)
+    , profiling_(true)
+    , numConnections_(0)
+    , recentFunctors_(0)
+    , lagEwmaNs_(0)
+    , busySinceNs_(0)
+    , freeFunctors_(nullptr)
 {
     LOG_DEBUG("EventLoop created %p int thread %d", this, threadId_);
     if (t_loopInThisThread)
@@ -44,6 +79,10 @@ EventLoop::EventLoop()
         t_loopInThisThread = this;
     }
 
+#ifdef MUDUO_HAVE_IO_URING
+    ioUringPoller_ = dynamic_cast<IoUringPoller*>(poller_.get());
+#endif
+
     // 设置wakeupfd的事件类型以及发生事件后的回调操作
     wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
     // 每一个eventloop都将监听wakeupchannnel的EPOLLIN读事件
@@ -55,6 +94,18 @@ EventLoop::~EventLoop()
     wakeupChannel_->disableAll();
     wakeupChannel_->remove();
     ::close(wakeupFd_);
+    // 释放没有来得及执行的回调
+    while (PendingFunctor *node = pendingFunctors_.pop())
+    {
+        delete node;
+    }
+    PendingFunctor *node = freeFunctors_.exchange(nullptr);
+    while (node != nullptr)
+    {
+        PendingFunctor *next = node->next.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+    }
     t_loopInThisThread = nullptr;
 }
 
@@ -68,26 +119,88 @@ void EventLoop::loop()
     while (!quit_) 
     {
         activeChannels_.clear();
+        // 每轮开始时决定是否统计，统计的时候每个阶段和每个回调之间各读一次单调时钟
+        bool profiling = profiling_.load(std::memory_order_relaxed);
+        uint64_t pollStart = profiling ? EventLoopProfiler::nowNs() : 0;
+
         // 相当于revents存到activeChannels中
         // 这里之间两类fd，一种是client的fd，一种是wakeupfd
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        if (busyPollUs_.load(std::memory_order_relaxed) > 0)
+        {
+            pollReturnTime_ = busyPoll(&activeChannels_);
+        }
+        else
+        {
+            pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        }
+
+        uint64_t handlerStart = profiling ? EventLoopProfiler::nowNs() : 0;
+        busySinceNs_.store(handlerStart, std::memory_order_relaxed);
+        uint64_t last = handlerStart;
         for (Channel *Channel: activeChannels_) 
         {   
             // Poller监听那些channel发生事件，然后上报给EventLoop，通知channel处理相应的事件
             Channel->handleEvent(pollReturnTime_);
+            if (profiling)
+            {
+                uint64_t now = EventLoopProfiler::nowNs();
+                profiler_.recordCallback(now - last);
+                last = now;
+            }
         }
         // 执行当前EventLoop事件循环需要处理的回调操作
         /**
          * IO线程 mainLoop accept 只进行新用户的链接 fd 封装到channel中，
          * mainLoop 事先注册一个回调函数（需要由subloop执行）唤醒subloop执行之前mainloop注册的操作
          */
-        doPendingFunctors();
+        size_t numFunctors = doPendingFunctors(profiling);
+        // 在loop线程中记录这一轮执行的回调个数，投递的线程不需要额外的原子计数
+        recentFunctors_.store(numFunctors, std::memory_order_relaxed);
+        busySinceNs_.store(0, std::memory_order_relaxed);
+
+        if (profiling)
+        {
+            uint64_t end = EventLoopProfiler::nowNs();
+            profiler_.recordIteration(handlerStart - pollStart, last - handlerStart, end - last,
+                                      activeChannels_.size(), numFunctors);
+            // 滑动平均，新的一轮占1/8
+            uint64_t ewma = lagEwmaNs_.load(std::memory_order_relaxed);
+            lagEwmaNs_.store(ewma - ewma / 8 + (end - handlerStart) / 8, std::memory_order_relaxed);
+        }
     }
 
     LOG_INFO("EventLoop %p stop looping. \n", this);
     looping_ = false;
 }
 
+Timestamp EventLoop::busyPoll(ChannelList *activeChannels)
+{
+    int configured = busyPollUs_.load(std::memory_order_relaxed);
+    if (busyPollBudgetUs_ <= 0 || busyPollBudgetUs_ > configured)
+    {
+        busyPollBudgetUs_ = configured;
+    }
+
+    int64_t deadline = monotonicMicros() + busyPollBudgetUs_;
+    do
+    {
+        Timestamp now = poller_->poll(0, activeChannels);
+        busyPollSpins_.store(busyPollSpins_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (!activeChannels->empty())
+        {
+            // 自旋命中，预算加倍恢复到配置值
+            busyPollHits_.store(busyPollHits_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            busyPollBudgetUs_ = std::min(busyPollBudgetUs_ * 2, configured);
+            return now;
+        }
+    } while (monotonicMicros() < deadline && !quit_);
+
+    // 自旋落空，说明当前比较空闲，减少下一次的自旋预算，然后阻塞等待
+    busyPollBudgetUs_ = std::max(busyPollBudgetUs_ / 2, kMinBusyPollUs);
+    busyPollSleeps_.store(busyPollSleeps_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return poller_->poll(kPollTimeMs, activeChannels);
+}
+
 // 退出事件循环 1.loop在自己的线程中调用quit 2.在非loop的线程中，调用loop的quit
 void EventLoop::quit()
 {
@@ -108,16 +221,55 @@ void EventLoop::runInLoop(Functor cb)
     }
     else   // 在非当前线程访问cb，唤醒loop所在线程执行cb
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
-void EventLoop::queueInLoop(Functor cb)
+uint64_t EventLoop::loopLagNs() const
 {
+    uint64_t lag = lagEwmaNs_.load(std::memory_order_relaxed);
+    uint64_t busySince = busySinceNs_.load(std::memory_order_relaxed);
+    if (busySince != 0)
     {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
+        uint64_t now = EventLoopProfiler::nowNs();
+        if (now > busySince && now - busySince > lag)
+        {
+            lag = now - busySince;
+        }
     }
+    return lag;
+}
+
+void EventLoop::runInLoopAndWait(Functor cb)
+{
+    if (isInLoopThread())
+    {
+        cb();
+        return;
+    }
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    // 捕获的是指针，不会超过Functor的内联大小
+    Functor *task = &cb;
+    queueInLoop([task, &mutex, &cond, &done]() {
+        (*task)();
+        std::unique_lock<std::mutex> lock(mutex);
+        done = true;
+        cond.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!done)
+    {
+        cond.wait(lock);
+    }
+}
+
+void EventLoop::queueInLoop(Functor cb)
+{
+    PendingFunctor *node = allocFunctorNode();
+    node->functor = std::move(cb);
+    pendingFunctors_.push(node);
 
     // 唤醒相应的，需要执行上面回调操作的loop的线程，callingPendingFunctors_表示正在执行回调没有阻塞在其上
     if (!isInLoopThread() || callingPendingFunctors_)
@@ -126,14 +278,102 @@ void EventLoop::queueInLoop(Functor cb)
     }
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+// 每个线程缓存的空闲任务节点，节点在各个loop之间是通用的，线程退出时释放
+struct EventLoop::FunctorNodeCache
+{
+    PendingFunctor *head;
+
+    FunctorNodeCache() : head(nullptr) {}
+    ~FunctorNodeCache()
+    {
+        while (head != nullptr)
+        {
+            PendingFunctor *node = head;
+            head = node->next.load(std::memory_order_relaxed);
+            delete node;
+        }
+    }
+};
+
+EventLoop::PendingFunctor* EventLoop::allocFunctorNode()
+{
+    static thread_local FunctorNodeCache cache;
+
+    if (cache.head == nullptr)
+    {
+        // 一次取走本loop归还的所有节点
+        cache.head = freeFunctors_.exchange(nullptr, std::memory_order_acquire);
+        if (cache.head == nullptr)
+        {
+            return new PendingFunctor;
+        }
+    }
+    PendingFunctor *node = cache.head;
+    cache.head = node->next.load(std::memory_order_relaxed);
+    return node;
+}
+
+void EventLoop::freeFunctorNode(PendingFunctor *node)
+{
+    // 只有loop线程会往freeFunctors_中放节点，其他线程只会整体取走，所以CAS不会有ABA问题
+    PendingFunctor *head = freeFunctors_.load(std::memory_order_relaxed);
+    do
+    {
+        node->next.store(head, std::memory_order_relaxed);
+    } while (!freeFunctors_.compare_exchange_weak(head, node,
+                std::memory_order_release, std::memory_order_relaxed));
+}
+
+TimingWheel* EventLoop::timingWheel()
+{
+    if (!timingWheel_)
+    {
+        timingWheel_.reset(new TimingWheel(this));
+    }
+    return timingWheel_.get();
+}
+
 // 用来唤醒loop所在的线程，向wakeupfd_写一个数据，wakeupChannel就发生都时间，当前的loop线程就会被唤醒
 void EventLoop::wakeup()
 {
+    // 只有第一个把wakeupPending_从false改成true的线程需要写eventfd
+    // 不能先用relaxed load检查：push中链接节点的store可能还在store buffer里，
+    // loop清除wakeupPending_后会看不到这个节点，又没有人写eventfd，任务就要等到poll超时；
+    // exchange是带lock的读改写，保证链接先于它对loop可见
+    if (wakeupPending_.exchange(true))
+    {
+        wakeupsSuppressed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    wakeupsIssued_.fetch_add(1, std::memory_order_relaxed);
+
     uint64_t one = 1;
     ssize_t n = write(wakeupFd_, &one, sizeof one);
     if (n != sizeof one)
     {
-        LOG_ERROR("EventLoop::wakeup() writes %lu bytes instead of 8 \n", n)
+        LOG_ERROR("EventLoop::wakeup() writes %lu bytes instead of 8 \n", n);
     }
 }
 
@@ -165,22 +405,38 @@ void EventLoop::handleRead()
     }
 }
 
-void EventLoop::doPendingFunctors()  // 执行回调函数
+size_t EventLoop::doPendingFunctors(bool profiling)  // 执行回调函数
 {   
-    // 使用这个局部变量进行置换，直接一次将所有需要执行的回调全部拿出来，不耽误其在向内添加
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
+    // 必须在取队列之前清除，之后入队的任务会重新写eventfd，不会丢失唤醒
+    wakeupPending_.store(false);
 
-    {   
-        // 这个锁是锁作用域的除了这个括号就释放
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_);
-    }
-
-    for (const Functor & functor : functors)
+    // 只执行进入本函数时已经在队列中的回调，执行过程中新加入的留到下一轮，避免loop被一直占用
+    size_t count = 0;
+    uint64_t callbackStart = profiling ? EventLoopProfiler::nowNs() : 0;
+    pendingFunctors_.beginBatch();
+    while (PendingFunctor *node = pendingFunctors_.popBatch())
     {
-        functor();
+        node->functor();
+        // 先析构捕获的对象（比如TcpConnectionPtr），再把节点归还复用
+        node->functor = nullptr;
+        freeFunctorNode(node);
+        ++count;
+        if (profiling)
+        {
+            uint64_t now = EventLoopProfiler::nowNs();
+            profiler_.recordCallback(now - callbackStart);
+            callbackStart = now;
+        }
     }
 
     callingPendingFunctors_ = false;
-}
\ No newline at end of file
+    return count;
+}
+
+EventLoopStats EventLoop::stats(bool resetMaxCallback)
+{
+    EventLoopStats result;
+    profiler_.snapshot(&result, resetMaxCallback);
+    return result;
+}
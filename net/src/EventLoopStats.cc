@@ -0,0 +1,107 @@
+#include "EventLoopStats.h"
+
+#include <time.h>
+
+uint64_t HistogramSnapshot::percentile(double p) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(p * count);
+    if (target >= count)
+    {
+        target = count - 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i)
+    {
+        seen += buckets[i];
+        if (seen > target)
+        {
+            uint64_t upper = i == 0 ? 0 : (uint64_t(1) << i) - 1;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+LoopHistogram::LoopHistogram()
+    : count_(0)
+    , sum_(0)
+    , max_(0)
+{
+    for (int i = 0; i < HistogramSnapshot::kBuckets; ++i)
+    {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LoopHistogram::add(uint64_t value)
+{
+    int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    if (bucket >= HistogramSnapshot::kBuckets)
+    {
+        bucket = HistogramSnapshot::kBuckets - 1;
+    }
+    bump(buckets_[bucket], 1);
+    bump(count_, 1);
+    bump(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed))
+    {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+void LoopHistogram::snapshot(HistogramSnapshot *out) const
+{
+    for (int i = 0; i < HistogramSnapshot::kBuckets; ++i)
+    {
+        out->buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    out->count = count_.load(std::memory_order_relaxed);
+    out->sum = sum_.load(std::memory_order_relaxed);
+    out->max = max_.load(std::memory_order_relaxed);
+}
+
+EventLoopProfiler::EventLoopProfiler()
+    : iterations_(0)
+    , pollNs_(0)
+    , handlerNs_(0)
+    , functorNs_(0)
+    , maxCallbackNs_(0)
+{
+}
+
+uint64_t EventLoopProfiler::nowNs()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void EventLoopProfiler::recordIteration(uint64_t pollNs, uint64_t handlerNs, uint64_t functorNs,
+                                        size_t numEvents, size_t numFunctors)
+{
+    iterations_.store(iterations_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    pollNs_.store(pollNs_.load(std::memory_order_relaxed) + pollNs, std::memory_order_relaxed);
+    handlerNs_.store(handlerNs_.load(std::memory_order_relaxed) + handlerNs, std::memory_order_relaxed);
+    functorNs_.store(functorNs_.load(std::memory_order_relaxed) + functorNs, std::memory_order_relaxed);
+    loopLagNs_.add(handlerNs + functorNs);
+    eventsPerIteration_.add(numEvents);
+    functorsPerIteration_.add(numFunctors);
+}
+
+void EventLoopProfiler::snapshot(EventLoopStats *out, bool resetMaxCallback)
+{
+    out->iterations = iterations_.load(std::memory_order_relaxed);
+    out->pollNs = pollNs_.load(std::memory_order_relaxed);
+    out->handlerNs = handlerNs_.load(std::memory_order_relaxed);
+    out->functorNs = functorNs_.load(std::memory_order_relaxed);
+    out->maxCallbackNs = resetMaxCallback
+        ? maxCallbackNs_.exchange(0, std::memory_order_relaxed)
+        : maxCallbackNs_.load(std::memory_order_relaxed);
+    loopLagNs_.snapshot(&out->loopLagNs);
+    eventsPerIteration_.snapshot(&out->eventsPerIteration);
+    functorsPerIteration_.snapshot(&out->functorsPerIteration);
+}
@@ -1,5 +1,9 @@
 #include "EventLoopThread.h"
 #include "EventLoop.h"
+#include "CpuTopology.h"
+#include "Logger.h"
+
+#include <errno.h>
 
 EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
     const std::string &name)
@@ -9,6 +13,7 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
     , mutex_()
     , cond_()
     , callback_(cb)
+    , numaNode_(-1)
 {
 
 }
@@ -43,8 +48,12 @@ EventLoop* EventLoopThread::startLoop()
 // 下面的方法是在单独的新线程中运行的
 void EventLoopThread::threadFunc()
 {   
+    // 先绑核再创建EventLoop，loop的poller、定时器等内存都分配在本地节点上
+    applyPlacement();
+
     // 这个函数是创建一个loop共上面的线程使用
     EventLoop loop;  // 创建一个独立的eventloop，和上面的线程是一一对应的
+    loop.setNumaNode(numaNode_);
 
     if (callback_)
     {
@@ -60,4 +69,15 @@ void EventLoopThread::threadFunc()
     loop.loop(); // EventLoop loop => Poller.poll
     std::unique_lock<std::mutex> lock(mutex_);
     loop_ = nullptr;
-}
\ No newline at end of file
+}
+void EventLoopThread::applyPlacement()
+{
+    if (!cpus_.empty() && !CpuTopology::pinCurrentThread(cpus_))
+    {
+        LOG_ERROR("EventLoopThread::applyPlacement - sched_setaffinity error:%d \n", errno);
+    }
+    if (numaNode_ >= 0 && !CpuTopology::preferNode(numaNode_))
+    {
+        LOG_ERROR("EventLoopThread::applyPlacement - set_mempolicy node %d error:%d \n", numaNode_, errno);
+    }
+}
@@ -1,7 +1,12 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "CpuTopology.h"
+#include "Logger.h"
 
 #include <memory>
+#include <time.h>
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
     : baseLoop_(baseLoop)
@@ -9,6 +14,9 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string
     , started_(false)
     , numThreads_(0)
     , next_(0)
+    , policy_(kRoundRobin)
+    , cpuPlacement_(kNoPinning)
+    , randomState_(static_cast<uint32_t>(::time(nullptr)) | 1)
 {
 
 }
@@ -27,6 +35,15 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
         char buf[name_.size() + 32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
         EventLoopThread *t = new EventLoopThread(cb, buf);
+        if (cpuPlacement_ != kNoPinning)
+        {
+            std::vector<int> cpus;
+            int numaNode = -1;
+            placementFor(i, &cpus, &numaNode);
+            t->setPlacement(cpus, numaNode);
+            LOG_INFO("EventLoopThreadPool [%s] loop %d => cpu %d (%zu cpus), numa node %d \n",
+                name_.c_str(), i, cpus.empty() ? -1 : cpus.front(), cpus.size(), numaNode);
+        }
         // 这里是获取一个线程，但是线程获取后还没有真正的执行loop
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         // 只有调用startLoop()之后loop才真正的被启动
@@ -41,24 +58,114 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 }
 
 
-EventLoop* EventLoopThreadPool::getNextLoop()
+void EventLoopThreadPool::placementFor(int index, std::vector<int> *cpus, int *numaNode) const
 {
-    EventLoop *loop = baseLoop_;
+    switch (cpuPlacement_)
+    {
+    case kNumaLocal:
+    {
+        std::vector<int> nodes = CpuTopology::numaNodes();
+        *numaNode = nodes[index % nodes.size()];
+        *cpus = CpuTopology::cpusOfNode(*numaNode);
+        return;
+    }
+    case kPhysicalCores:
+    case kCpuList:
+    {
+        std::vector<int> candidates = cpuPlacement_ == kCpuList ? cpuList_ : CpuTopology::physicalCores();
+        if (candidates.empty())
+        {
+            LOG_ERROR("EventLoopThreadPool [%s] empty cpu list, loop %d not pinned \n", name_.c_str(), index);
+            return;
+        }
+        int cpu = candidates[index % candidates.size()];
+        cpus->assign(1, cpu);
+        *numaNode = CpuTopology::nodeOfCpu(cpu);
+        return;
+    }
+    default:
+        return;
+    }
+}
 
-    // 轮询获取loop
-    if (!loops_.empty())
+EventLoop* EventLoopThreadPool::getNextLoop()
+{
+    if (loops_.empty())
+    {
+        return baseLoop_;
+    }
+    switch (policy_)
+    {
+    case kLeastConnections:
     {
-        loop = loops_[next_];
-        next_++;
-        if (next_ >= loops_.size())
+        EventLoop *loop = loops_[0];
+        for (EventLoop *candidate : loops_)
         {
-            next_ = 0;
+            if (candidate->numConnections() < loop->numConnections())
+            {
+                loop = candidate;
+            }
         }
+        return loop;
     }
+    case kPowerOfTwoLag:
+        return powerOfTwo([](EventLoop *loop) { return static_cast<int64_t>(loop->loopLagNs()); });
+    case kPowerOfTwoQueue:
+        return powerOfTwo([](EventLoop *loop) { return loop->recentFunctorCount(); });
+    default:
+        return roundRobin();
+    }
+}
+
+EventLoop* EventLoopThreadPool::getNextLoop(const InetAddress &peerAddr)
+{
+    if (policy_ != kHashPeer || loops_.empty())
+    {
+        return getNextLoop();
+    }
+    // 只用IP，同一个客户端的多条连接落在同一个loop；乘法哈希打散相邻的地址
+    uint32_t ip = ntohl(peerAddr.getSockAddr()->sin_addr.s_addr);
+    uint32_t hash = ip * 2654435761u;
+    return loops_[(static_cast<uint64_t>(hash) * loops_.size()) >> 32];
+}
 
+EventLoop* EventLoopThreadPool::roundRobin()
+{
+    // 轮询获取loop
+    EventLoop *loop = loops_[next_];
+    next_++;
+    if (static_cast<size_t>(next_) >= loops_.size())
+    {
+        next_ = 0;
+    }
     return loop;
 }
 
+template <typename Load>
+EventLoop* EventLoopThreadPool::powerOfTwo(Load load)
+{
+    size_t n = loops_.size();
+    if (n == 1)
+    {
+        return loops_[0];
+    }
+    size_t first = nextRandom() % n;
+    size_t second = (first + 1 + nextRandom() % (n - 1)) % n;
+    EventLoop *a = loops_[first];
+    EventLoop *b = loops_[second];
+    return load(b) < load(a) ? b : a;
+}
+
+uint32_t EventLoopThreadPool::nextRandom()
+{
+    uint32_t x = randomState_;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    randomState_ = x;
+    return x;
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
 {
     if (loops_.empty())
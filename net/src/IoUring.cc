@@ -0,0 +1,214 @@
+#ifdef MUDUO_HAVE_IO_URING
+
+#include "IoUring.h"
+#include "Logger.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+static int sysIoUringSetup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int sysIoUringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+                           unsigned flags, void *arg, size_t argSize)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+IoUring::IoUring(unsigned entries)
+    : ringFd_(-1)
+    , sqRing_(MAP_FAILED)
+    , sqRingSize_(0)
+    , cqRing_(MAP_FAILED)
+    , cqRingSize_(0)
+    , sqes_(static_cast<io_uring_sqe*>(MAP_FAILED))
+    , sqesSize_(0)
+    , sqLocalTail_(0)
+    , sqSubmitted_(0)
+    , numEnters_(0)
+{
+    // 完成队列设置为提交队列的4倍，减少溢出
+    memset(&params_, 0, sizeof params_);
+    params_.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params_.cq_entries = entries * 4;
+    int fd = sysIoUringSetup(entries, &params_);
+    if (fd < 0 && errno == EINVAL)
+    {
+        // 老内核不支持COOP_TASKRUN
+        memset(&params_, 0, sizeof params_);
+        params_.flags = IORING_SETUP_CQSIZE;
+        params_.cq_entries = entries * 4;
+        fd = sysIoUringSetup(entries, &params_);
+    }
+    if (fd < 0)
+    {
+        LOG_ERROR("io_uring_setup error:%d \n", errno);
+        return;
+    }
+    if (!(params_.features & IORING_FEAT_EXT_ARG))
+    {
+        // poll的超时依赖IORING_ENTER_EXT_ARG（5.11）
+        LOG_ERROR("io_uring does not support IORING_FEAT_EXT_ARG \n");
+        ::close(fd);
+        return;
+    }
+
+    sqRingSize_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+    sqesSize_ = params_.sq_entries * sizeof(io_uring_sqe);
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+    cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (sqRing_ == MAP_FAILED || cqRing_ == MAP_FAILED || sqes_ == MAP_FAILED)
+    {
+        LOG_ERROR("io_uring mmap error:%d \n", errno);
+        ::close(fd);
+        return;
+    }
+
+    char *sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params_.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+    sqLocalTail_ = sqSubmitted_ = *sqTail_;
+
+    char *cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params_.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+
+    ringFd_ = fd;
+}
+
+IoUring::~IoUring()
+{
+    if (sqes_ != MAP_FAILED)
+    {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    if (ringFd_ >= 0)
+    {
+        ::close(ringFd_);
+    }
+}
+
+io_uring_sqe* IoUring::getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqLocalTail_ - head >= params_.sq_entries)
+    {
+        // 提交队列满了，先提交给内核腾出位置
+        submitAndWait(0);
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqLocalTail_ - head >= params_.sq_entries)
+        {
+            return nullptr;
+        }
+    }
+    unsigned index = sqLocalTail_ & sqMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof *sqe);
+    sqArray_[index] = index;
+    ++sqLocalTail_;
+    return sqe;
+}
+
+int IoUring::submitAndWait(int timeoutMs)
+{
+    unsigned toSubmit = sqLocalTail_ - sqSubmitted_;
+    if (toSubmit > 0)
+    {
+        // 发布新的提交项，内核通过acquire读取tail
+        __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    }
+
+    unsigned minComplete = 0;
+    if (timeoutMs != 0)
+    {
+        // 已经有完成项的时候不需要等待
+        if (__atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) == *cqHead_)
+        {
+            minComplete = 1;
+        }
+    }
+    if (toSubmit == 0 && minComplete == 0)
+    {
+        return 0;
+    }
+
+    int ret = enter(toSubmit, minComplete, minComplete > 0 ? timeoutMs : 0);
+    if (ret >= 0)
+    {
+        sqSubmitted_ += static_cast<unsigned>(ret) < toSubmit ? ret : toSubmit;
+    }
+    return ret;
+}
+
+int IoUring::enter(unsigned toSubmit, unsigned minComplete, int timeoutMs)
+{
+    io_uring_getevents_arg arg;
+    __kernel_timespec ts;
+    memset(&arg, 0, sizeof arg);
+    if (timeoutMs > 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+
+    ++numEnters_;
+    int ret = sysIoUringEnter(ringFd_, toSubmit, minComplete,
+                              IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof arg);
+    if (ret < 0)
+    {
+        int saveErrno = errno;
+        // 超时和信号中断都是正常情况
+        if (saveErrno != ETIME && saveErrno != EINTR && saveErrno != EAGAIN && saveErrno != EBUSY)
+        {
+            LOG_ERROR("io_uring_enter error:%d \n", saveErrno);
+        }
+        errno = saveErrno;
+    }
+    return ret;
+}
+
+io_uring_cqe* IoUring::peekCqe()
+{
+    unsigned head = *cqHead_;
+    if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE))
+    {
+        return nullptr;
+    }
+    return &cqes_[head & cqMask_];
+}
+
+void IoUring::cqeSeen()
+{
+    __atomic_store_n(cqHead_, *cqHead_ + 1, __ATOMIC_RELEASE);
+}
+
+int IoUring::registerOp(unsigned opcode, void *arg, unsigned nrArgs)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, ringFd_, opcode, arg, nrArgs));
+}
+
+#endif // MUDUO_HAVE_IO_URING
@@ -0,0 +1,581 @@
+#ifdef MUDUO_HAVE_IO_URING
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+
+#include "IoUringPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+
+// 和EPollPoller相同的channel状态，保存在channels_中
+const int kNew = ChannelTable::kNew;
+const int kAdded = ChannelTable::kAdded;
+const int kDeleted = ChannelTable::kDeleted;
+
+// fd只占低24位，足够表示进程的fd
+static uint64_t makeUserData(int fd, uint32_t op, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << 32) | (op << 24) | (static_cast<uint32_t>(fd) & 0xffffff);
+}
+
+IoUringPoller::IoState::IoState()
+    : recvGeneration(0)
+    , recvWanted(false)
+    , recvArmed(false)
+    , recvFinished(false)
+    , recvErrno(0)
+    , sendGeneration(0)
+    , pendingSend(nullptr)
+    , sendInFlight(false)
+    , sent(0)
+    , sendErrno(0)
+{
+}
+
+IoUringPoller::Registration::Registration()
+    : channel(nullptr)
+    , generation(0)
+    , armedEvents(0)
+    , dirty(false)
+    , revents(0)
+{
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop)
+    , bufRing_(nullptr)
+    , bufRingSize_(0)
+    , bufTail_(0)
+    , ring_(kRingEntries)
+{
+    if (ring_.valid())
+    {
+        setupBufferRing();
+    }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    if (bufRing_ != nullptr)
+    {
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof reg);
+        reg.bgid = kBufferGroup;
+        ring_.registerOp(IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        ::munmap(bufRing_, bufRingSize_);
+    }
+}
+
+void IoUringPoller::setupBufferRing()
+{
+    bufRingSize_ = kBufferCount * sizeof(io_uring_buf);
+    void *mem = ::mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        LOG_ERROR("IoUringPoller::setupBufferRing mmap error:%d \n", errno);
+        return;
+    }
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof reg);
+    reg.ring_addr = reinterpret_cast<uint64_t>(mem);
+    reg.ring_entries = kBufferCount;
+    reg.bgid = kBufferGroup;
+    if (ring_.registerOp(IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        // 内核太老，只能使用就绪通知
+        LOG_INFO("IoUringPoller provided buffer ring unsupported:%d, completion mode disabled \n", errno);
+        ::munmap(mem, bufRingSize_);
+        return;
+    }
+
+    // 不通过io_uring_buf_ring访问：它的柔性数组在C++中会多出一个空结构体，偏移不对
+    // ring就是一个io_uring_buf数组，tail和第一个元素的resv重叠
+    bufRing_ = static_cast<io_uring_buf*>(mem);
+    bufferPool_.resize(static_cast<size_t>(kBufferCount) * kBufferSize);
+    for (unsigned i = 0; i < kBufferCount; ++i)
+    {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+}
+
+void IoUringPoller::recycleBuffer(uint16_t bid)
+{
+    io_uring_buf *buf = &bufRing_[bufTail_ & (kBufferCount - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(bufferAddr(bid));
+    buf->len = kBufferSize;
+    buf->bid = bid;
+    ++bufTail_;
+    // 内核通过acquire读取tail，保证看到上面写入的缓冲区
+    __atomic_store_n(&bufRing_[0].resv, bufTail_, __ATOMIC_RELEASE);
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_INFO("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
+    flushDirty();
+    ring_.submitAndWait(timeoutMs);
+    Timestamp now(Timestamp::now());
+
+    while (io_uring_cqe *cqe = ring_.peekCqe())
+    {
+        uint64_t userData = cqe->user_data;
+        int res = cqe->res;
+        uint32_t flags = cqe->flags;
+        ring_.cqeSeen();
+
+        if (userData == kInternalUserData)
+        {
+            continue;
+        }
+        int fd = static_cast<int>(userData & 0xffffff);
+        uint32_t op = static_cast<uint32_t>(userData >> 24) & 0xff;
+        uint32_t generation = static_cast<uint32_t>(userData >> 32);
+        switch (op)
+        {
+        case kPollOp:
+            handlePollCompletion(fd, generation, res, activeChannels);
+            break;
+        case kRecvOp:
+            handleRecvCompletion(fd, generation, res, flags, activeChannels);
+            break;
+        case kSendOp:
+            handleSendCompletion(userData, fd, generation, res, activeChannels);
+            break;
+        }
+    }
+
+    // 同一个channel的多个完成项合并成一次事件
+    int numEvents = static_cast<int>(activeChannels->size());
+    for (Channel *channel : *activeChannels)
+    {
+        Registration &reg = registrations_[channel->fd()];
+        channel->set_revents(reg.revents);
+        reg.revents = 0;
+    }
+
+    if (numEvents > 0)
+    {
+        LOG_INFO("%d envetns happend \n", numEvents);
+    }
+    return now;
+}
+
+void IoUringPoller::activate(Registration &reg, int revents, ChannelList *activeChannels)
+{
+    if (reg.revents == 0)
+    {
+        activeChannels->push_back(reg.channel);
+    }
+    reg.revents |= revents;
+}
+
+void IoUringPoller::handlePollCompletion(int fd, uint32_t generation, int res, ChannelList *activeChannels)
+{
+    if (static_cast<size_t>(fd) >= registrations_.size())
+    {
+        return;
+    }
+    Registration &reg = registrations_[fd];
+    if (reg.generation != generation || reg.channel == nullptr)
+    {
+        // 已经被替换或者删除的请求
+        return;
+    }
+
+    // 单次poll已经完成，需要重新注册
+    reg.armedEvents = 0;
+    markDirty(fd);
+
+    if (res < 0)
+    {
+        if (res != -ECANCELED)
+        {
+            LOG_ERROR("IoUringPoller::poll fd=%d error:%d \n", fd, -res);
+            activate(reg, POLLERR, activeChannels);
+        }
+        return;
+    }
+    activate(reg, res, activeChannels);
+}
+
+void IoUringPoller::handleRecvCompletion(int fd, uint32_t generation, int res, uint32_t flags,
+                                         ChannelList *activeChannels)
+{
+    IoState *io = nullptr;
+    if (static_cast<size_t>(fd) < registrations_.size())
+    {
+        io = registrations_[fd].io.get();
+    }
+    if (io == nullptr || io->recvGeneration != generation)
+    {
+        // 已经停止接收的连接，内核选中的缓冲区直接还回去
+        if (flags & IORING_CQE_F_BUFFER)
+        {
+            recycleBuffer(static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        return;
+    }
+
+    Registration &reg = registrations_[fd];
+    if (res > 0)
+    {
+        io->received.emplace_back(static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT), res);
+        activate(reg, POLLIN, activeChannels);
+    }
+    else if (res == 0 || (res != -ENOBUFS && res != -ECANCELED))
+    {
+        // 对端关闭或者出错，和readFd返回0/-1一样交给handleRead处理
+        io->recvFinished = true;
+        io->recvErrno = res < 0 ? -res : 0;
+        activate(reg, POLLIN, activeChannels);
+    }
+
+    if (!(flags & IORING_CQE_F_MORE))
+    {
+        // multishot请求结束了（比如缓冲区用完返回ENOBUFS），下次提交前重新注册
+        io->recvArmed = false;
+        markDirty(fd);
+    }
+}
+
+void IoUringPoller::handleSendCompletion(uint64_t userData, int fd, uint32_t generation, int res,
+                                         ChannelList *activeChannels)
+{
+    IoState *io = nullptr;
+    if (static_cast<size_t>(fd) < registrations_.size())
+    {
+        io = registrations_[fd].io.get();
+    }
+    if (io == nullptr || io->sendGeneration != generation || !io->sendInFlight)
+    {
+        // 连接已经删除，现在可以释放发送缓冲区了
+        orphanedSends_.erase(userData);
+        return;
+    }
+
+    Registration &reg = registrations_[fd];
+    io->sendInFlight = false;
+    if (res < 0)
+    {
+        io->sendErrno = -res;
+        io->sendBuffer.retrieveAll();
+        activate(reg, POLLOUT, activeChannels);
+        return;
+    }
+
+    io->sent += res;
+    io->sendBuffer.retrieve(res);
+    if (io->sendBuffer.readableBytes() > 0)
+    {
+        // 只发送了一部分，下次提交前继续发送剩下的
+        markDirty(fd);
+    }
+    else
+    {
+        activate(reg, POLLOUT, activeChannels);
+    }
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    int fd = channel->fd();
+    ChannelTable::Entry &entry = channels_.add(fd, channel);
+    const int index = entry.state;
+    LOG_INFO("fd=%d evetns=%d index=%d \n", fd, channel->events(), index);
+
+    if (index == kNew || index == kDeleted)
+    {
+        registration(fd).channel = channel;
+        entry.state = kAdded;
+    }
+    else if (channel->isNoneEvent())
+    {
+        entry.state = kDeleted;
+        // 和epoll一样，disableAll之后不再有读事件
+        Registration &reg = registration(fd);
+        if (reg.io)
+        {
+            stopRecv(fd, *reg.io);
+        }
+    }
+    // 真正的注册推迟到下一次poll之前，一轮中多次修改只会提交最后的结果
+    markDirty(fd);
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    int fd = channel->fd();
+    channels_.remove(fd);
+    Registration &reg = registration(fd);
+    disarm(reg, fd);
+    if (reg.io)
+    {
+        IoState &io = *reg.io;
+        stopRecv(fd, io);
+        if (io.sendInFlight)
+        {
+            // 取消发送，请求完成之前内核可能还在读取缓冲区，先把它保存下来
+            uint64_t userData = makeUserData(fd, kSendOp, io.sendGeneration);
+            std::unique_ptr<ChainBuffer> orphan(new ChainBuffer);
+            orphan->swap(io.sendBuffer);
+            orphanedSends_[userData] = std::move(orphan);
+            cancel(userData);
+        }
+        reg.io.reset();
+    }
+    reg.channel = nullptr;
+    reg.revents = 0;
+}
+
+void IoUringPoller::startRecv(Channel *channel)
+{
+    int fd = channel->fd();
+    channels_.add(fd, channel).state = kAdded;
+
+    Registration &reg = registration(fd);
+    reg.channel = channel;
+    if (!reg.io)
+    {
+        reg.io.reset(new IoState);
+    }
+    reg.io->recvWanted = true;
+    markDirty(fd);
+}
+
+size_t IoUringPoller::takeReceived(int fd, Buffer *buf, bool *finished, int *saveErrno)
+{
+    IoState *io = registration(fd).io.get();
+    if (io == nullptr)
+    {
+        *finished = false;
+        return 0;
+    }
+
+    size_t n = 0;
+    for (const std::pair<uint16_t, uint32_t> &chunk : io->received)
+    {
+        buf->append(bufferAddr(chunk.first), chunk.second);
+        recycleBuffer(chunk.first);
+        n += chunk.second;
+    }
+    io->received.clear();
+    *finished = io->recvFinished;
+    *saveErrno = io->recvErrno;
+    return n;
+}
+
+void IoUringPoller::requestSend(Channel *channel, ChainBuffer *buf)
+{
+    int fd = channel->fd();
+    IoState *io = registration(fd).io.get();
+    if (io == nullptr)
+    {
+        LOG_ERROR("IoUringPoller::requestSend fd=%d not in completion mode \n", fd);
+        return;
+    }
+    // 真正的交换推迟到提交前，这一轮后面追加的数据也能一起发送
+    io->pendingSend = buf;
+    markDirty(fd);
+}
+
+ssize_t IoUringPoller::takeSent(int fd, int *saveErrno)
+{
+    IoState *io = registration(fd).io.get();
+    if (io == nullptr)
+    {
+        return 0;
+    }
+    ssize_t n = io->sent;
+    io->sent = 0;
+    if (io->sendErrno != 0)
+    {
+        *saveErrno = io->sendErrno;
+        io->sendErrno = 0;
+        return -1;
+    }
+    return n;
+}
+
+void IoUringPoller::armRecv(int fd, IoState &io)
+{
+    io_uring_sqe *sqe = ring_.getSqe();
+    if (sqe == nullptr)
+    {
+        LOG_FATAL("IoUringPoller::armRecv submission queue full fd=%d \n", fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = makeUserData(fd, kRecvOp, io.recvGeneration);
+    io.recvArmed = true;
+}
+
+void IoUringPoller::submitSend(int fd, IoState &io)
+{
+    io_uring_sqe *sqe = ring_.getSqe();
+    if (sqe == nullptr)
+    {
+        LOG_FATAL("IoUringPoller::submitSend submission queue full fd=%d \n", fd);
+        return;
+    }
+    ++io.sendGeneration;
+    // 发送缓冲区的分段一次交给内核，最多IOV_MAX个，剩下的在这次完成后继续发送
+    io.sendIov.resize(std::min(io.sendBuffer.numSegments(), static_cast<size_t>(IOV_MAX)));
+    int iovcnt = io.sendBuffer.fillIovec(io.sendIov.data(), static_cast<int>(io.sendIov.size()));
+    ::memset(&io.sendMsg, 0, sizeof io.sendMsg);
+    io.sendMsg.msg_iov = io.sendIov.data();
+    io.sendMsg.msg_iovlen = iovcnt;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&io.sendMsg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = makeUserData(fd, kSendOp, io.sendGeneration);
+    io.sendInFlight = true;
+}
+
+void IoUringPoller::stopRecv(int fd, IoState &io)
+{
+    io.recvWanted = false;
+    if (io.recvArmed)
+    {
+        cancel(makeUserData(fd, kRecvOp, io.recvGeneration));
+        io.recvArmed = false;
+    }
+    // 代数加一，取消之前已经返回的完成项会被丢弃（缓冲区会被回收）
+    ++io.recvGeneration;
+    for (const std::pair<uint16_t, uint32_t> &chunk : io.received)
+    {
+        recycleBuffer(chunk.first);
+    }
+    io.received.clear();
+}
+
+void IoUringPoller::cancel(uint64_t userData)
+{
+    io_uring_sqe *sqe = ring_.getSqe();
+    if (sqe == nullptr)
+    {
+        LOG_ERROR("IoUringPoller::cancel submission queue full \n");
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = kInternalUserData;
+}
+
+IoUringPoller::Registration& IoUringPoller::registration(int fd)
+{
+    if (static_cast<size_t>(fd) >= registrations_.size())
+    {
+        registrations_.resize(std::max(static_cast<size_t>(fd) + 1, 2 * registrations_.size()));
+    }
+    return registrations_[fd];
+}
+
+void IoUringPoller::markDirty(int fd)
+{
+    Registration &reg = registration(fd);
+    if (!reg.dirty)
+    {
+        reg.dirty = true;
+        dirtyFds_.push_back(fd);
+    }
+}
+
+void IoUringPoller::flushDirty()
+{
+    for (int fd : dirtyFds_)
+    {
+        Registration &reg = registrations_[fd];
+        reg.dirty = false;
+
+        uint32_t wanted = 0;
+        if (reg.channel != nullptr && channels_.find(fd)->state == kAdded)
+        {
+            wanted = static_cast<uint32_t>(reg.channel->events());
+        }
+        if (wanted != reg.armedEvents)
+        {
+            disarm(reg, fd);
+            if (wanted != 0)
+            {
+                arm(fd, reg, wanted);
+            }
+        }
+
+        if (reg.io)
+        {
+            IoState &io = *reg.io;
+            if (io.recvWanted && !io.recvArmed && !io.recvFinished)
+            {
+                armRecv(fd, io);
+            }
+            if (!io.sendInFlight)
+            {
+                if (io.sendBuffer.readableBytes() > 0)
+                {
+                    submitSend(fd, io);
+                }
+                else if (io.pendingSend != nullptr)
+                {
+                    io.sendBuffer.swap(*io.pendingSend);
+                    io.pendingSend = nullptr;
+                    submitSend(fd, io);
+                }
+            }
+        }
+    }
+    dirtyFds_.clear();
+}
+
+void IoUringPoller::arm(int fd, Registration &reg, uint32_t events)
+{
+    io_uring_sqe *sqe = ring_.getSqe();
+    if (sqe == nullptr)
+    {
+        LOG_FATAL("IoUringPoller::arm submission queue full fd=%d \n", fd);
+        return;
+    }
+    ++reg.generation;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // 单次poll在注册时会先检查一次就绪状态，每轮重新注册即可得到水平触发的语义
+    sqe->poll32_events = events;
+    sqe->user_data = makeUserData(fd, kPollOp, reg.generation);
+    reg.armedEvents = events;
+}
+
+void IoUringPoller::disarm(Registration &reg, int fd)
+{
+    if (reg.armedEvents == 0)
+    {
+        return;
+    }
+    io_uring_sqe *sqe = ring_.getSqe();
+    if (sqe == nullptr)
+    {
+        LOG_ERROR("IoUringPoller::disarm submission queue full fd=%d \n", fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, kPollOp, reg.generation);
+    sqe->user_data = kInternalUserData;
+    // 代数加一，被删除的请求即使已经完成，完成项也会被丢弃
+    ++reg.generation;
+    reg.armedEvents = 0;
+}
+
+#endif // MUDUO_HAVE_IO_URING
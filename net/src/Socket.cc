@@ -32,7 +32,7 @@ void Socket::listen()
 {
     if (::listen(sockfd_, 1024) != 0) 
     {
-        LOG_FATAL("listen sockfd:%d fail \n", sockfd_)
+        LOG_FATAL("listen sockfd:%d fail \n", sockfd_);
     }
 }
 
@@ -0,0 +1,139 @@
+#include "Strand.h"
+#include "TcpConnection.h"
+
+Strand::Strand(ThreadPool *pool)
+    : pool_(pool)
+    , running_(false)
+{
+}
+
+void Strand::post(Task task)
+{
+    if (enqueue(std::move(task)))
+    {
+        schedule();
+    }
+}
+
+bool Strand::enqueue(Task task)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    if (running_)
+    {
+        return false;
+    }
+    running_ = true;
+    return true;
+}
+
+void Strand::schedule()
+{
+    pool_->run(std::bind(&Strand::runNext, shared_from_this()));
+}
+
+bool Strand::idle() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return !running_ && tasks_.empty();
+}
+
+void Strand::runNext()
+{
+    Task task;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+    }
+    task();
+    task = nullptr;
+
+    bool more = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        more = !tasks_.empty();
+        running_ = more;
+    }
+    if (more)
+    {
+        schedule();
+    }
+    else if (idleCallback_)
+    {
+        idleCallback_();
+    }
+}
+
+ConnectionExecutor::ConnectionExecutor(ThreadPool *pool)
+    : pool_(pool)
+    , map_(std::make_shared<StrandMap>())
+{
+}
+
+void ConnectionExecutor::dispatch(const TcpConnectionPtr &conn, Work work)
+{
+    post(conn, [conn, work]() {
+        std::string response = work();
+        if (!response.empty())
+        {
+            // 前一个请求的响应先投递到loop，loop按投递顺序执行，响应的顺序和请求一致
+            void (TcpConnection::*fp)(const std::string &buf) = &TcpConnection::send;
+            conn->getLoop()->runInLoop(std::bind(fp, conn, std::move(response)));
+        }
+    });
+}
+
+void ConnectionExecutor::post(const TcpConnectionPtr &conn, Strand::Task task)
+{
+    // 加入队列时持有执行器的锁，release不会在这期间把Strand删掉；
+    // 投递在锁外进行，线程池没有工作线程时任务会直接执行，执行完会调用release
+    std::shared_ptr<Strand> strand;
+    bool schedule = false;
+    {
+        std::unique_lock<std::mutex> lock(map_->mutex);
+        strand = strandOf(conn.get());
+        schedule = strand->enqueue(std::move(task));
+    }
+    if (schedule)
+    {
+        strand->schedule();
+    }
+}
+
+size_t ConnectionExecutor::activeConnections() const
+{
+    std::unique_lock<std::mutex> lock(map_->mutex);
+    return map_->strands.size();
+}
+
+std::shared_ptr<Strand> ConnectionExecutor::strandOf(TcpConnection *conn)
+{
+    std::shared_ptr<Strand> &strand = map_->strands[conn];
+    if (!strand)
+    {
+        strand = std::make_shared<Strand>(pool_);
+        // 不绑定this，执行器析构之后工作线程里的Strand执行完也不会访问它
+        strand->setIdleCallback(std::bind(&ConnectionExecutor::release,
+                                          std::weak_ptr<StrandMap>(map_), conn));
+    }
+    return strand;
+}
+
+void ConnectionExecutor::release(const std::weak_ptr<StrandMap> &weakMap, TcpConnection *conn)
+{
+    std::shared_ptr<StrandMap> map = weakMap.lock();
+    if (!map)
+    {
+        // 执行器已经析构
+        return;
+    }
+    // Strand在等锁的时候可能又收到了新任务，这时不能删除
+    // 最后一个任务执行完之后连接可能已经析构，地址被新连接复用也没有关系，Strand只是一个串行队列
+    std::unique_lock<std::mutex> lock(map->mutex);
+    auto it = map->strands.find(conn);
+    if (it != map->strands.end() && it->second->idle())
+    {
+        map->strands.erase(it);
+    }
+}
@@ -4,6 +4,7 @@
 #include "Channel.h"
 #include "EventLoop.h"
 #include "Buffer.h"
+#include "IoUringPoller.h"
 
 #include <functional>
 #include <errno.h>
@@ -27,11 +28,15 @@ TcpConnection::TcpConnection(EventLoop *loop,
         , name_(nameArg)
         , state_(kConnecting)
         , reading_(true)
+        , completionMode_(false)
+        , edgeTriggered_(false)
+        , sending_(false)
         , socket_(new Socket(sockfd))
         , channel_(new Channel(loop, sockfd))
         , localAddr_(localAddr)
         , peerAddr_(peerAddr)
         , highWaterMark_(64*1024*1024)  // 64M
+        , idleTimeout_(0.0)
 {   
     channel_->setReadCallback(
     std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
@@ -44,29 +49,49 @@ TcpConnection::TcpConnection(EventLoop *loop,
 
     LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
     socket_->setKeepAlive(true);
+    loop_->adjustConnections(1);
 }
 
 TcpConnection::~TcpConnection()
 {
     LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d\n", 
         name_.c_str(), channel_->fd(), (int)state_);
+    loop_->adjustConnections(-1);
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    if (completionMode_)
+    {
+        handleReadCompletion(receiveTime);
+        return;
+    }
+
     int saveErrno = 0;
+    ssize_t total = 0;
+    ssize_t n = 0;
     // 每个连接对应一个socked和Channel
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &saveErrno);
-    if (n > 0)
+    // 边沿触发时必须一直读到EAGAIN（或者对端关闭），否则剩下的数据不会再有通知
+    do
+    {
+        n = inputBuffer_.readFd(channel_->fd(), &saveErrno);
+        if (n > 0)
+        {
+            total += n;
+        }
+    } while (n > 0 && channel_->edgeTriggered());
+
+    if (total > 0)
     {
+        refreshIdleTimeout();
         // 已经建立的用户，有可读事件发生，调用用户传入的回调函数onMessage
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
     }
-    else if (n == 0)
+    if (n == 0)
     {
         handleClose();
     }
-    else
+    else if (n < 0 && saveErrno != EAGAIN)
     {
         errno = saveErrno;
         LOG_ERROR("TcpConnection::handleRead");
@@ -76,13 +101,31 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 
 void TcpConnection::handleWrite()
 {   
+    if (completionMode_)
+    {
+        handleWriteCompletion();
+        return;
+    }
+
     if (channel_->isWriting())
     {      
         int saveErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &saveErrno);
-        if (n > 0)
+        ssize_t total = 0;
+        ssize_t n = 0;
+        // 边沿触发时一直写到缓冲区空或者EAGAIN，剩下的等下一次EPOLLOUT
+        do
         {
-            outputBuffer_.retrieve(n);
+            n = outputBuffer_.writeFd(channel_->fd(), &saveErrno);
+            if (n > 0)
+            {
+                total += n;
+                outputBuffer_.retrieve(n);
+            }
+        } while (n > 0 && channel_->edgeTriggered() && outputBuffer_.readableBytes() > 0);
+
+        if (total > 0)
+        {
+            refreshIdleTimeout();
             if (outputBuffer_.readableBytes() == 0)
             {
                 channel_->disableWriting();
@@ -116,6 +159,10 @@ void TcpConnection::handleClose()
     LOG_INFO("fd=%d state=%d \n", channel_->fd(), (int)state_);
     setState(kDisconnected);
     channel_->disableAll();
+    if (idleEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&idleEntry_);
+    }
 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr);       // 执行连接关闭的回调
@@ -148,7 +195,25 @@ void TcpConnection::send(const std::string &buf)
         }
         else
         {   
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLooop, this, buf.c_str(), buf.size()));
+            // 跨线程发送必须拷贝一份数据，buf在调用返回后可能已经被释放
+            void (TcpConnection::*fp)(const std::string &message) = &TcpConnection::sendInLooop;
+            loop_->runInLoop(std::bind(fp, shared_from_this(), buf));
+        }
+    }
+}
+
+void TcpConnection::send(const std::shared_ptr<const std::string> &data)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendSharedInLoop(data);
+        }
+        else
+        {
+            // 只拷贝shared_ptr，不拷贝数据
+            loop_->runInLoop(std::bind(&TcpConnection::sendSharedInLoop, shared_from_this(), data));
         }
     }
 }
@@ -163,7 +228,7 @@ void TcpConnection::shutdown()
 }
 
 // 发送数据，应用写的快，内核发送数据慢，需要把待发送的数据写入缓冲过去，而且设置了水位回调
-void TcpConnection::sendInLooop(const void* message, size_t len)
+void TcpConnection::sendInLooop(const void* message, size_t len, std::shared_ptr<const void> owner)
 {
     ssize_t nwrote = 0;
     size_t remaining = len;
@@ -175,6 +240,24 @@ void TcpConnection::sendInLooop(const void* message, size_t len)
         return;
     }
 
+    if (completionMode_)
+    {
+        // 先放进发送缓冲区，本轮结束后和其它连接的发送一起提交
+        size_t oldLen = outputBuffer_.readableBytes();
+        if (oldLen + len >= highWaterMark_
+            && oldLen < highWaterMark_
+            && highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + len));
+        }
+        appendOutput(static_cast<const char*>(message), len, std::move(owner));
+        if (!sending_)
+        {
+            requestSendCompletion();
+        }
+        return;
+    }
+
     if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
     {
         nwrote = ::write(channel_->fd(), message, len);
@@ -213,7 +296,7 @@ void TcpConnection::sendInLooop(const void* message, size_t len)
         {
             loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
         }
-        outputBuffer_.append((const char*)message + nwrote, remaining);
+        appendOutput((const char*)message + nwrote, remaining, std::move(owner));
         if (!channel_->isWriting())
         {   
             // 这里必须要注册channel的写事件，否则poller不会监听tcp连接的发送缓冲区是否可写
@@ -222,19 +305,60 @@ void TcpConnection::sendInLooop(const void* message, size_t len)
     }
 }
 
+void TcpConnection::sendInLooop(const std::string &message)
+{
+    sendInLooop(message.data(), message.size());
+}
+
+void TcpConnection::sendSharedInLoop(const std::shared_ptr<const std::string> &data)
+{
+    sendInLooop(data->data(), data->size(), data);
+}
+
+void TcpConnection::appendOutput(const char *data, size_t len, std::shared_ptr<const void> owner)
+{
+    // 小块数据直接拷贝合并，不值得单独占一个分段（writev一次最多IOV_MAX个分段）
+    if (owner && len >= ChainBuffer::kBlockSize / 4)
+    {
+        outputBuffer_.appendExternal(data, len, std::move(owner));
+    }
+    else
+    {
+        outputBuffer_.append(data, len);
+    }
+}
+
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting()) // 说明发送缓冲区的数据已经发送完成
+    if (!channel_->isWriting() && !sending_) // 说明发送缓冲区的数据已经发送完成
     {
         socket_->shutdownWrite();
     }
 }
 
+void TcpConnection::setTcpNoDelay(bool on)
+{
+    socket_->setTcpNoDelay(on);
+}
+
 void TcpConnection::connectEstablished()
 {
     setState(kConnected);
     channel_->tie(shared_from_this());
-    channel_->enableReading();  // 向poller注册channel的读事件
+    channel_->setEdgeTriggered(edgeTriggered_);
+    if (loop_->numaNode() >= 0)
+    {
+        // 缓冲区是在接收连接的线程中分配的，在本loop线程中重新分配，内存落在loop所在的NUMA节点
+        Buffer input;
+        ChainBuffer output;
+        inputBuffer_.swap(input);
+        outputBuffer_.swap(output);
+    }
+    if (!completionMode_ || !startCompletion())
+    {
+        completionMode_ = false;
+        channel_->enableReading();  // 向poller注册channel的读事件
+    }
 
     // 已经建立连接，执行用户传入的回调操作
     connectionCallback_(shared_from_this());
@@ -249,5 +373,144 @@ void TcpConnection::connectDestroyed()
 
         connectionCallback_(shared_from_this());
     }
+    if (idleEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&idleEntry_);
+    }
     channel_->remove();
-}
\ No newline at end of file
+}
+
+void TcpConnection::setIdleTimeout(double seconds)
+{
+    loop_->runInLoop(std::bind(&TcpConnection::setIdleTimeoutInLoop, shared_from_this(), seconds));
+}
+
+void TcpConnection::setIdleTimeoutInLoop(double seconds)
+{
+    idleTimeout_ = seconds;
+    if (idleTimeout_ > 0.0)
+    {
+        // 条目是TcpConnection的成员，连接关闭时会先从时间轮上摘下，所以这里可以直接绑定this
+        idleEntry_.setCallback(std::bind(&TcpConnection::handleIdleTimeout, this));
+        loop_->timingWheel()->touch(&idleEntry_, idleTimeout_);
+    }
+    else if (idleEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&idleEntry_);
+    }
+}
+
+void TcpConnection::refreshIdleTimeout()
+{
+    if (idleTimeout_ > 0.0)
+    {
+        loop_->timingWheel()->touch(&idleEntry_, idleTimeout_);
+    }
+}
+
+// 空闲超时，主动关闭连接
+void TcpConnection::handleIdleTimeout()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        LOG_INFO("TcpConnection::handleIdleTimeout [%s] idle for %.1f seconds, closing \n",
+            name_.c_str(), idleTimeout_);
+        handleClose();
+    }
+}
+
+
+#ifdef MUDUO_HAVE_IO_URING
+
+bool TcpConnection::startCompletion()
+{
+    IoUringPoller *poller = loop_->ioUringPoller();
+    if (poller == nullptr || !poller->completionSupported())
+    {
+        return false;
+    }
+    poller->startRecv(channel_.get());
+    return true;
+}
+
+void TcpConnection::handleReadCompletion(Timestamp receiveTime)
+{
+    int saveErrno = 0;
+    bool finished = false;
+    size_t n = loop_->ioUringPoller()->takeReceived(channel_->fd(), &inputBuffer_, &finished, &saveErrno);
+    if (n > 0)
+    {
+        refreshIdleTimeout();
+        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    }
+    if (finished && state_ != kDisconnected)
+    {
+        // multishot recv已经结束，出错时也不会再有事件，直接关闭连接
+        if (saveErrno != 0)
+        {
+            errno = saveErrno;
+            LOG_ERROR("TcpConnection::handleRead");
+            handleError();
+        }
+        handleClose();
+    }
+}
+
+void TcpConnection::handleWriteCompletion()
+{
+    int saveErrno = 0;
+    ssize_t n = loop_->ioUringPoller()->takeSent(channel_->fd(), &saveErrno);
+    sending_ = false;
+    if (n < 0)
+    {
+        errno = saveErrno;
+        LOG_ERROR("TcpConnection::handleWrite");
+        // 发送失败，缓冲区中剩下的数据不会再发出去了
+        outputBuffer_.retrieveAll();
+        if (saveErrno == EPIPE || saveErrno == ECONNRESET)
+        {
+            // 对端已经关闭，不等multishot recv出错，和handleReadCompletion一样直接关闭连接
+            if (state_ != kDisconnected)
+            {
+                handleError();
+                handleClose();
+            }
+        }
+        else if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+        return;
+    }
+
+    refreshIdleTimeout();
+    if (outputBuffer_.readableBytes() > 0)
+    {
+        // 发送期间又追加了数据
+        requestSendCompletion();
+        return;
+    }
+    if (writeCompleteCallback_)
+    {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisconnecting)
+    {
+        shutdownInLoop();
+    }
+}
+
+void TcpConnection::requestSendCompletion()
+{
+    sending_ = true;
+    loop_->ioUringPoller()->requestSend(channel_.get(), &outputBuffer_);
+}
+
+#else
+
+bool TcpConnection::startCompletion() { return false; }
+void TcpConnection::handleReadCompletion(Timestamp receiveTime) {}
+void TcpConnection::handleWriteCompletion() {}
+void TcpConnection::requestSendCompletion() {}
+
+#endif // MUDUO_HAVE_IO_URING
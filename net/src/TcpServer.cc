@@ -1,4 +1,5 @@
 #include "TcpServer.h"
+#include "sockets.h"
 
 #include <functional>
 #include <strings.h>
@@ -26,20 +27,41 @@ TcpServer::TcpServer(EventLoop *loop,
             : loop_(CheckLoopNotNull(loop))
             , ipPort_(listenAddr.toIpPort())
             , name_(nameArg)
-            , acceptor_(new Acceptor(loop, listenAddr, option == KReusePost))
+            , listenAddr_(listenAddr)
+            , reusePort_(option == KReusePost)
+            , connNamePrefix_(nameArg + "-" + ipPort_ + "#")
+            , wildcardListen_(listenAddr.getSockAddr()->sin_addr.s_addr == htonl(INADDR_ANY))
+            , acceptor_(new Acceptor(loop, listenAddr, reusePort_))
             , threadPool_(new EventLoopThreadPool(loop, name_))
             , connectionCallback_()
             , messageCallback_()
-            , nextConnId_(1)
             , started_(0)
+            , nextConnId_(1)
+            , busyPollUs_(0)
+            , socketBusyPollUs_(0)
+            , completionMode_(false)
+            , edgeTriggered_(false)
+            , acceptMode_(kBaseLoopAccept)
+            , steerByCpu_(false)
+            , acceptBatch_(Acceptor::kDefaultAcceptBatch)
 {   
     // 当有新用户连接的时候会执行这个回调
-    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
-        std::placeholders::_1, std::placeholders::_2));
+    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnections, this,
+        nullptr, std::placeholders::_1));
 }
 
 TcpServer::~TcpServer()
 {
+    // 分片的Acceptor和共享监听的Channel属于各自的subLoop，必须在那个loop中销毁，并且等它销毁完，
+    // 之后就不会再有新连接回调到这个已经析构的TcpServer；threadPool_先于acceptor_析构，这里要先注销
+    for (std::unique_ptr<Acceptor> &acceptor : shardAcceptors_)
+    {
+        Acceptor *ptr = acceptor.release();
+        ptr->ownerLoop()->runInLoopAndWait([ptr]() { delete ptr; });
+    }
+    acceptor_->stopShared();
+
+    std::unique_lock<std::mutex> lock(connectionsMutex_);
     for (auto &item : connections_)
     {   
         // 这是一个栈上的对象，TcpConnectionPtr是shared_ptr智能指针
@@ -56,39 +78,167 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setBusyPoll(int loopSpinUs, int socketBusyPollUs)
+{
+    busyPollUs_ = loopSpinUs;
+    socketBusyPollUs_ = socketBusyPollUs;
+}
+
+void TcpServer::setShardedAccept(bool on, bool steerByCpu)
+{
+    if (on && !reusePort_)
+    {
+        LOG_ERROR("TcpServer::setShardedAccept [%s] requires KReusePost, ignored \n", name_.c_str());
+        return;
+    }
+    acceptMode_ = on ? kShardedAccept : kBaseLoopAccept;
+    steerByCpu_ = steerByCpu;
+}
+
+void TcpServer::setSharedAccept(bool on)
+{
+    acceptMode_ = on ? kSharedAccept : kBaseLoopAccept;
+}
+
 void TcpServer::start()
 {   
     if (started_++ == 0)   // 防止一个TcpSercver对象被start多次
     {
         // 启动底层的loop线程池
         threadPool_->start(threadInitCallback_);      
+        if (busyPollUs_ > 0)
+        {
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                ioLoop->setBusyPollUs(busyPollUs_);
+            }
+        }
+        acceptor_->setAcceptBatch(acceptBatch_);
+        // 没有subLoop时仍然由mainLoop接收
+        if (acceptMode_ != kBaseLoopAccept && threadPool_->getAllLoops().front() != loop_)
+        {
+            if (acceptMode_ == kShardedAccept)
+            {
+                startShards();
+            }
+            else
+            {
+                startShared();
+            }
+            return;
+        }
         // 开始监听 acceptChannel有无感兴趣的新事件（新连接）
         loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
     }
 }
 
+void TcpServer::startShards()
+{
+    // mainLoop的acceptor_只绑定不监听，连接全部由subLoop的Acceptor接收
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    for (EventLoop *ioLoop : loops)
+    {
+        Acceptor *acceptor = new Acceptor(ioLoop, listenAddr_, true);
+        acceptor->setNewConnectionCallback(std::bind(&TcpServer::newConnections, this, ioLoop,
+            std::placeholders::_1));
+        acceptor->setAcceptBatch(acceptBatch_);
+        shardAcceptors_.push_back(std::unique_ptr<Acceptor>(acceptor));
+    }
+    if (steerByCpu_)
+    {
+        sockets::attachReuseportCpuSteering(shardAcceptors_.front()->fd(), static_cast<int>(loops.size()));
+    }
+    // 在当前线程中按顺序listen，第i个socket在reuseport组中的下标就是i
+    for (std::unique_ptr<Acceptor> &acceptor : shardAcceptors_)
+    {
+        acceptor->listenSocket();
+    }
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        loops[i]->runInLoop(std::bind(&Acceptor::listen, shardAcceptors_[i].get()));
+    }
+    LOG_INFO("TcpServer::start [%s] sharded accept on %zu loops%s \n",
+        name_.c_str(), loops.size(), steerByCpu_ ? ", steered by cpu" : "");
+}
+
 // 有一个新的用户连接，acceptor会执行这个回调操作
-void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
+void TcpServer::startShared()
+{
+    // acceptor_只提供listen socket，不注册到mainLoop
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    for (EventLoop *ioLoop : loops)
+    {
+        acceptor_->listenShared(ioLoop, std::bind(&TcpServer::newConnections, this, ioLoop,
+            std::placeholders::_1));
+    }
+    LOG_INFO("TcpServer::start [%s] shared accept on %zu loops \n", name_.c_str(), loops.size());
+}
+
+void TcpServer::newConnections(EventLoop *ioLoop, const Acceptor::AcceptedList &accepted)
+{
+    // 按subLoop分组，每组只需要一次runInLoop（一次唤醒）
+    std::vector<std::pair<EventLoop*, std::vector<TcpConnectionPtr>>> batches;
+    for (const Acceptor::Accepted &item : accepted)
+    {
+        // 按分配策略选择一个subloop
+        EventLoop *target = ioLoop ? ioLoop : threadPool_->getNextLoop(item.peerAddr);
+        auto it = batches.begin();
+        while (it != batches.end() && it->first != target)
+        {
+            ++it;
+        }
+        if (it == batches.end())
+        {
+            batches.emplace_back(target, std::vector<TcpConnectionPtr>());
+            it = batches.end() - 1;
+        }
+        it->second.push_back(createConnection(target, item.sockfd, item.peerAddr));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex_);
+        for (auto &batch : batches)
+        {
+            for (const TcpConnectionPtr &conn : batch.second)
+            {
+                connections_[conn->name()] = conn;
+            }
+        }
+    }
+
+    for (auto &batch : batches)
+    {
+        // 直接调用TcpConnection的connectEstablished方法，表示连接建立成功
+        batch.first->runInLoop(std::bind(&TcpServer::establishConnections, std::move(batch.second)));
+    }
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
 {
-    // 轮询算法选择一个subloop
-    EventLoop *ioLoop = threadPool_->getNextLoop();
     // 生成一个TcpConnection连接对象
-    char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
-    std::string connName = name_ + buf;
+    std::string connName = connNamePrefix_ + std::to_string(nextConnId_++);
 
-    LOG_INFO("TcpServer::newConnection [%s] - new connection from %s \n",
+    LOG_DEBUG("TcpServer::newConnection [%s] - new connection from %s \n",
         connName.c_str(), peerAddr.toIpPort().c_str());
 
-    sockaddr_in local;
-    ::bzero(&local, sizeof local);
-    socklen_t addrlen = sizeof local;
-    if (::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0)
+    // 本端地址就是监听地址，只有监听INADDR_ANY时才需要getsockname
+    InetAddress localAddr(listenAddr_);
+    if (wildcardListen_)
+    {
+        sockaddr_in local;
+        ::bzero(&local, sizeof local);
+        socklen_t addrlen = sizeof local;
+        if (::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0)
+        {
+            LOG_ERROR("TcpServer::newConnection - getsockname error \n");
+        }
+        localAddr.setSockAddr(local);
+    }
+
+    if (socketBusyPollUs_ > 0)
     {
-        LOG_ERROR("TcpServer::newConnection - getsockname error \n");
+        sockets::setBusyPoll(sockfd, socketBusyPollUs_);
     }
-    InetAddress localAddr(local);
 
     // 创建TcpConnection对象
     TcpConnectionPtr conn(new TcpConnection(
@@ -98,22 +248,34 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
         localAddr,
         peerAddr));
 
-    connections_[connName] = conn;
-    
     // 下面的回调都是用户设置给TcpServer的，然后TcpServer传递给TcpConnection
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setCompletionMode(completionMode_);
+    conn->setEdgeTriggered(edgeTriggered_);
     conn->setCloseCallback(
         std::bind(&TcpServer::removeConnction, this, std::placeholders::_1));
+    return conn;
+}
 
-    // 直接调用TcpConnection的connectEstablished方法，表示连接建立成功
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+void TcpServer::establishConnections(const std::vector<TcpConnectionPtr> &conns)
+{
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        conn->connectEstablished();
+    }
 }
 
 void TcpServer::removeConnction(const TcpConnectionPtr &conn)
 {
     // 该函数可能在非loop线程中调用
+    if (acceptMode_ != kBaseLoopAccept)
+    {
+        // subLoop自己接收连接时不经过mainLoop，直接在所属的loop中删除
+        removeConnctionInLoop(conn);
+        return;
+    }
     loop_->runInLoop(std::bind(&TcpServer::removeConnctionInLoop, this, conn));
 }
 
@@ -121,7 +283,10 @@ void TcpServer::removeConnctionInLoop(const TcpConnectionPtr & conn)
 {
     LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection \n", conn->name().c_str());
     
-    connections_.erase(conn->name());
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex_);
+        connections_.erase(conn->name());
+    }
     EventLoop *ioLoop = conn->getLoop();
     // 在ioLoop中销毁连接
     ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
@@ -0,0 +1,225 @@
+#include "ThreadPool.h"
+#include "Thread.h"
+#include "Logger.h"
+
+#include <stdio.h>
+
+// 当前线程所属的线程池和在池中的下标，不是工作线程时为nullptr
+static __thread ThreadPool *t_pool = nullptr;
+static __thread int t_workerIndex = -1;
+
+static uint32_t xorshift(uint32_t *seed)
+{
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+ThreadPool::ThreadPool(const std::string &name)
+    : name_(name)
+    , numThreads_(0)
+    , nextWorker_(0)
+    , pending_(0)
+    , sleepers_(0)
+    , running_(false)
+    , tasksRun_(0)
+    , tasksStolen_(0)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void ThreadPool::start()
+{
+    if (running_ || !workers_.empty())
+    {
+        LOG_ERROR("ThreadPool::start %s already started \n", name_.c_str());
+        return;
+    }
+    running_ = true;
+    for (int i = 0; i < numThreads_; ++i)
+    {
+        workers_.push_back(std::unique_ptr<Worker>(new Worker));
+    }
+    // 所有队列都创建好之后再启动线程，工作线程会访问其他线程的队列
+    for (int i = 0; i < numThreads_; ++i)
+    {
+        char buf[name_.size() + 32];
+        snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
+        threads_.push_back(std::unique_ptr<Thread>(
+            new Thread(std::bind(&ThreadPool::threadFunc, this, i), buf)));
+        threads_.back()->start();
+    }
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        running_ = false;
+        wakeCond_.notify_all();
+    }
+    for (std::unique_ptr<Thread> &thread : threads_)
+    {
+        thread->join();
+    }
+    threads_.clear();
+
+    // 工作线程退出时没有看到的任务（和stop同时提交的）在这里执行掉，不会丢失
+    Task task;
+    for (std::unique_ptr<Worker> &worker : workers_)
+    {
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(worker->mutex);
+                if (worker->tasks.empty())
+                {
+                    break;
+                }
+                task = std::move(worker->tasks.front());
+                worker->tasks.pop_front();
+            }
+            pending_.fetch_sub(1);
+            task();
+            task = nullptr;
+        }
+    }
+}
+
+void ThreadPool::run(Task task)
+{
+    // stop之后没有工作线程取任务了，和没有工作线程一样直接执行，continuation也不会丢
+    if (workers_.empty() || !running_)
+    {
+        task();
+        return;
+    }
+
+    // 工作线程中提交的任务放进自己的队列，其他线程轮流分配
+    int index = t_pool == this
+        ? t_workerIndex
+        : static_cast<int>(nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size());
+    Worker &worker = *workers_[index];
+    {
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    // 先增加pending_再检查sleepers_，睡眠的线程先增加sleepers_再检查pending_，两边至少有一边能看到对方
+    pending_.fetch_add(1);
+    if (sleepers_.load() > 0)
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wakeCond_.notify_one();
+    }
+}
+
+void ThreadPool::run(Task work, EventLoop *loop, EventLoop::Functor continuation)
+{
+    struct Chained
+    {
+        Task work;
+        EventLoop *loop;
+        EventLoop::Functor continuation;
+
+        void operator()()
+        {
+            work();
+            loop->runInLoop(std::move(continuation));
+        }
+    };
+    // Chained超过了Task的内联大小，会在堆上分配一次
+    run(Chained{std::move(work), loop, std::move(continuation)});
+}
+
+void ThreadPool::threadFunc(int index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+    uint32_t seed = static_cast<uint32_t>(index) * 2654435761u + 1;
+    if (threadInitCallback_)
+    {
+        threadInitCallback_();
+    }
+
+    Task task;
+    while (true)
+    {
+        if (takeTask(index, &seed, &task))
+        {
+            pending_.fetch_sub(1);
+            task();
+            task = nullptr;
+            tasksRun_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepers_.fetch_add(1);
+        while (pending_.load() == 0 && running_)
+        {
+            wakeCond_.wait(lock);
+        }
+        sleepers_.fetch_sub(1);
+        // stop之后把剩下的任务做完再退出
+        if (!running_ && pending_.load() == 0)
+        {
+            break;
+        }
+    }
+    t_pool = nullptr;
+    t_workerIndex = -1;
+}
+
+bool ThreadPool::takeTask(int index, uint32_t *seed, Task *task)
+{
+    // 自己的队列从队尾取
+    Worker &self = *workers_[index];
+    {
+        std::unique_lock<std::mutex> lock(self.mutex);
+        if (!self.tasks.empty())
+        {
+            *task = std::move(self.tasks.back());
+            self.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // 从随机位置开始依次尝试其他线程的队列
+    int n = static_cast<int>(workers_.size());
+    int start = static_cast<int>(xorshift(seed) % n);
+    for (int i = 0; i < n; ++i)
+    {
+        int victim = (start + i) % n;
+        if (victim != index && stealTask(victim, task))
+        {
+            tasksStolen_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::stealTask(int victim, Task *task)
+{
+    Worker &worker = *workers_[victim];
+    // 别人正在操作这个队列时直接跳过，不在偷任务上排队
+    std::unique_lock<std::mutex> lock(worker.mutex, std::try_to_lock);
+    if (!lock.owns_lock() || worker.tasks.empty())
+    {
+        return false;
+    }
+    *task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    return true;
+}
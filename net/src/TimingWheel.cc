@@ -0,0 +1,192 @@
+#include "TimingWheel.h"
+#include "EventLoop.h"
+
+#include <math.h>
+
+TimingWheel::Entry::Entry()
+    : wheel_(nullptr)
+    , expireTick_(0)
+{
+    prev = nullptr;
+    next = nullptr;
+}
+
+TimingWheel::Entry::~Entry()
+{
+    if (linked())
+    {
+        wheel_->remove(this);
+    }
+}
+
+TimingWheel::TimingWheel(EventLoop *loop, double tickSeconds)
+    : loop_(loop)
+    , tickSeconds_(tickSeconds)
+    , currentTick_(0)
+    , size_(0)
+{
+    for (int level = 0; level < kLevels; ++level)
+    {
+        for (int slot = 0; slot < kSlots; ++slot)
+        {
+            listInit(&slots_[level][slot]);
+        }
+    }
+    tickTimer_ = loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::tick, this));
+}
+
+TimingWheel::~TimingWheel()
+{
+    loop_->cancel(tickTimer_);
+    // 剩下的条目不再到期，只是从链表上摘下
+    for (int level = 0; level < kLevels; ++level)
+    {
+        for (int slot = 0; slot < kSlots; ++slot)
+        {
+            Node *head = &slots_[level][slot];
+            while (head->next != head)
+            {
+                Entry *entry = static_cast<Entry*>(head->next);
+                listUnlink(entry);
+                entry->wheel_ = nullptr;
+            }
+        }
+    }
+}
+
+void TimingWheel::touch(Entry *entry, double timeoutSeconds)
+{
+    int64_t ticks = static_cast<int64_t>(ceil(timeoutSeconds / tickSeconds_));
+    if (ticks < 1)
+    {
+        ticks = 1;
+    }
+    uint64_t expireTick = currentTick_ + static_cast<uint64_t>(ticks);
+
+    if (entry->linked())
+    {
+        // 同一个tick内的多次读写只有第一次需要移动条目
+        if (entry->expireTick_ == expireTick)
+        {
+            return;
+        }
+        listUnlink(entry);
+    }
+    else
+    {
+        ++size_;
+    }
+
+    entry->wheel_ = this;
+    entry->expireTick_ = expireTick;
+    place(entry);
+}
+
+void TimingWheel::remove(Entry *entry)
+{
+    if (entry->linked())
+    {
+        listUnlink(entry);
+        entry->wheel_ = nullptr;
+        --size_;
+    }
+}
+
+void TimingWheel::tick()
+{
+    ++currentTick_;
+
+    // 低层转完一圈，逐级把高层当前槽中的条目迁移下来
+    for (int level = 1; level < kLevels; ++level)
+    {
+        if ((currentTick_ & ((uint64_t(1) << (kLevelBits * level)) - 1)) != 0)
+        {
+            break;
+        }
+        cascade(level);
+    }
+
+    // 先把到期的槽整体移到局部链表，回调中再touch或remove其他条目也不会破坏遍历
+    Node expired;
+    listInit(&expired);
+    Node *head = &slots_[0][currentTick_ & (kSlots - 1)];
+    if (head->next != head)
+    {
+        expired.next = head->next;
+        expired.prev = head->prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        listInit(head);
+    }
+
+    while (expired.next != &expired)
+    {
+        Entry *entry = static_cast<Entry*>(expired.next);
+        listUnlink(entry);
+        if (entry->expireTick_ > currentTick_)
+        {
+            place(entry);
+            continue;
+        }
+        entry->wheel_ = nullptr;
+        --size_;
+        if (entry->callback_)
+        {
+            entry->callback_();
+        }
+    }
+}
+
+void TimingWheel::cascade(int level)
+{
+    Node *head = &slots_[level][(currentTick_ >> (kLevelBits * level)) & (kSlots - 1)];
+    while (head->next != head)
+    {
+        Entry *entry = static_cast<Entry*>(head->next);
+        listUnlink(entry);
+        place(entry);
+    }
+}
+
+void TimingWheel::place(Entry *entry)
+{
+    uint64_t expireTick = entry->expireTick_;
+    uint64_t delta = expireTick > currentTick_ ? expireTick - currentTick_ : 0;
+
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (uint64_t(1) << (kLevelBits * (level + 1))))
+    {
+        ++level;
+    }
+    // 超过时间轮范围的条目先放在最高层的最远槽，迁移时再重新计算
+    uint64_t maxDelta = (uint64_t(1) << (kLevelBits * kLevels)) - 1;
+    if (delta > maxDelta)
+    {
+        expireTick = currentTick_ + maxDelta;
+    }
+
+    int slot = static_cast<int>((expireTick >> (kLevelBits * level)) & (kSlots - 1));
+    listAppend(&slots_[level][slot], entry);
+}
+
+void TimingWheel::listInit(Node *head)
+{
+    head->prev = head;
+    head->next = head;
+}
+
+void TimingWheel::listAppend(Node *head, Node *node)
+{
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void TimingWheel::listUnlink(Node *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = nullptr;
+    node->next = nullptr;
+}
@@ -14,9 +14,21 @@
 #include <netinet/tcp.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <linux/filter.h>
 
 using namespace sockets;
 
+// 老版本的头文件中可能没有这两个选项
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
 // 私有工具函数：错误日志打印
 namespace
 {
@@ -152,6 +164,32 @@ void sockets::setKeepAlive(int sockfd)
     setSocketIntOpt(sockfd, SOL_SOCKET, SO_KEEPALIVE, 1);
 }
 
+void sockets::setBusyPoll(int sockfd, int usec)
+{
+    setSocketIntOpt(sockfd, SOL_SOCKET, SO_BUSY_POLL, usec);
+    setSocketIntOpt(sockfd, SOL_SOCKET, SO_PREFER_BUSY_POLL, usec > 0 ? 1 : 0);
+}
+
+bool sockets::attachReuseportCpuSteering(int sockfd, int numSockets)
+{
+    // A = 当前CPU; A %= numSockets; return A
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(numSockets) },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof code / sizeof code[0];
+    prog.filter = code;
+    if (::setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof prog) < 0)
+    {
+        LOG_ERROR("sockets::attachReuseportCpuSteering fail, sockfd=%d, errno=%d, info=%s",
+                  sockfd, errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
 // ✅ IPv4专属强转：sockaddr_in -> sockaddr
 const struct sockaddr* sockets::sockaddr_cast(const struct sockaddr_in* addr)
 {
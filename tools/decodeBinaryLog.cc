@@ -0,0 +1,147 @@
+#include "BinaryLog.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * 把BinaryLog写的二进制文件转换成文本，输出到stdout
+ * 用法：decodeBinaryLog 文件...
+ */
+
+class Reader
+{
+public:
+    explicit Reader(FILE *fp) : fp_(fp) {}
+
+    bool read(void *buf, size_t len) { return len == 0 || ::fread(buf, 1, len, fp_) == len; }
+    bool readU32(uint32_t *v) { return read(v, sizeof *v); }
+    bool readString(std::string *s)
+    {
+        uint32_t len;
+        if (!readU32(&len))
+        {
+            return false;
+        }
+        s->resize(len);
+        return read(&(*s)[0], len);
+    }
+
+private:
+    FILE *fp_;
+};
+
+static bool decode(const char *path)
+{
+    FILE *fp = ::fopen(path, "r");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "open %s failed: %s\n", path, strerror(errno));
+        return false;
+    }
+    Reader reader(fp);
+
+    char magic[sizeof BinaryLog::kFileMagic];
+    uint32_t version = 0;
+    BinaryLog::ClockBase clock;
+    if (!reader.read(magic, sizeof magic)
+        || ::memcmp(magic, BinaryLog::kFileMagic, sizeof magic) != 0
+        || !reader.readU32(&version)
+        || version != BinaryLog::kFileVersion
+        || !reader.read(&clock.ticksPerNs, sizeof clock.ticksPerNs)
+        || !reader.read(&clock.baseTicks, sizeof clock.baseTicks)
+        || !reader.read(&clock.baseRealtimeNs, sizeof clock.baseRealtimeNs))
+    {
+        fprintf(stderr, "%s: not a binary log (version %u)\n", path, version);
+        ::fclose(fp);
+        return false;
+    }
+
+    std::map<uint32_t, BinaryLog::SiteInfo> sites;
+    std::vector<char> records;
+    std::string text;
+    uint64_t numRecords = 0;
+    bool ok = true;
+    char tag;
+    while (ok && reader.read(&tag, 1))
+    {
+        if (tag == BinaryLog::kSiteTag)
+        {
+            uint32_t id, line;
+            BinaryLog::SiteInfo site;
+            ok = reader.readU32(&id) && reader.readU32(&line)
+                && reader.readString(&site.file)
+                && reader.readString(&site.format)
+                && reader.readString(&site.argTypes);
+            site.line = static_cast<int>(line);
+            sites[id] = site;
+        }
+        else if (tag == BinaryLog::kRecordsTag)
+        {
+            uint32_t tid, len;
+            ok = reader.readU32(&tid) && reader.readU32(&len);
+            records.resize(len);
+            ok = ok && reader.read(records.data(), len);
+            size_t pos = 0;
+            while (ok && pos + sizeof(BinaryLog::RecordHeader) <= records.size())
+            {
+                BinaryLog::RecordHeader header;
+                ::memcpy(&header, records.data() + pos, sizeof header);
+                auto it = sites.find(header.siteId);
+                if (header.size < sizeof header || pos + header.size > records.size() || it == sites.end())
+                {
+                    fprintf(stderr, "%s: corrupted record\n", path);
+                    ok = false;
+                    break;
+                }
+                text.clear();
+                BinaryLog::formatRecord(it->second, static_cast<int>(tid), records.data() + pos, clock, &text);
+                ::fwrite(text.data(), 1, text.size(), stdout);
+                pos += header.size;
+                ++numRecords;
+            }
+        }
+        else if (tag == BinaryLog::kDroppedTag)
+        {
+            uint32_t tid;
+            uint64_t count;
+            ok = reader.readU32(&tid) && reader.read(&count, sizeof count);
+            if (ok)
+            {
+                printf("[ERROR] thread %u dropped %llu records\n", tid, (unsigned long long)count);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "%s: unknown tag 0x%02x\n", path, static_cast<unsigned char>(tag));
+            ok = false;
+        }
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "%s: truncated after %llu records\n", path, (unsigned long long)numRecords);
+    }
+    ::fclose(fp);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s binarylog...\n", argv[0]);
+        return 1;
+    }
+    int failed = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!decode(argv[i]))
+        {
+            ++failed;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}